@@ -0,0 +1,294 @@
+/*  ═══════════════════════════════════════════════════════════════════════════
+    Benchmark harness for the CDCL solver.
+
+    Each instance is read into memory once, then loaded and solved by a
+    fresh Solver --warmup times untimed and --runs times timed, all in this
+    one process, so the numbers carry no process start-up or file system
+    noise.  Two phases are timed separately:
+
+        parse   Solver setup plus decoding the buffer (DIMACS, .cnfb or a
+                puzzle file), including the at-most-one extraction
+        solve   the bitboard fast path for puzzle files up to 16x16, or
+                simplification, search and model extension
+
+    and their p50/p95/p99 are printed per instance.  --csv=FILE also writes
+    one row per instance in the columns Main/plot_results.py reads, with
+    enc_time and sat_time the parse and solve medians in seconds, followed
+    by the run count and the percentiles in milliseconds.  cnf_vars and
+    cnf_clauses are the encoding before the Sudoku rules are applied, as
+    benchmark.py reports it, even when the timed runs apply them.
+
+    Build:  gcc -O2 -std=c11 -pthread -o cdcl_bench cdcl_bench.c
+    Usage:  ./cdcl_bench [options] file|directory|manifest ...
+    ═══════════════════════════════════════════════════════════════════════════ */
+
+#define CDCL_BENCH                /* drops cdcl_implementation.c's main      */
+
+/* the batch, portfolio and cube drivers are compiled in but not used here */
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+#include "cdcl_implementation.c"
+
+#include <math.h>
+
+#define BENCH_RUNS    10
+#define BENCH_WARMUP  2
+
+typedef struct {
+    int    runs, warmup;
+    int    restart_policy;
+    bool   preprocess;
+    bool   simplify;
+    bool   fast_path;
+    Budget budget;
+} BenchOpts;
+
+static int dbl_cmp(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int path_cmp(const void *a, const void *b) {
+    return strcmp(((const BatchJob *)a)->path, ((const BatchJob *)b)->path);
+}
+
+/* nearest rank on a sorted sample: the smallest value >= p% of the runs */
+static double percentile(const double *v, int n, double p) {
+    int k = (int)ceil(p / 100.0 * n) - 1;
+    return v[k < 0 ? 0 : k >= n ? n - 1 : k];
+}
+
+/*
+ * plot_results.py groups rows the way puzzle_fetcher.py names the files;
+ * anything else falls back to the board size, as the 4x4..36x36 sets do.
+ */
+static void bench_group(const char *name, int N, char *out, size_t cap) {
+    static const char *const map[][2] = {
+        { "sudoku_9x9_17clue",       "17-clue"     },
+        { "sudoku_9x9_higher_clue",  "5-clue"      },
+        { "sudoku_9x9_5clue",        "5-clue"      },
+        { "sudoku_9x9_20plus",       "20plus-clue" },
+    };
+    for (size_t i = 0; i < sizeof map / sizeof map[0]; i++)
+        if (strncmp(name, map[i][0], strlen(map[i][0])) == 0) {
+            snprintf(out, cap, "%s", map[i][1]);
+            return;
+        }
+    snprintf(out, cap, "%dx%d", N, N);
+}
+
+/* basename without its extension, the 'puzzle' column */
+static void bench_name(const char *path, char *out, size_t cap) {
+    const char *b = strrchr(path, '/');
+    b = b ? b + 1 : path;
+    snprintf(out, cap, "%s", b);
+    char *dot = strrchr(out, '.');
+    if (dot && dot != out) *dot = '\0';
+}
+
+/*
+ * The cnf_vars and cnf_clauses columns: the encoding before the Sudoku
+ * rules fill cells in and simplify() rewrites it, the size benchmark.py
+ * reports, with or without --no-preprocess.  At-most-one groups count as
+ * their pairs.  Takes one untimed load of its own.
+ */
+static void bench_size(const char *buf, size_t len, int *vars, long *clauses) {
+    bool    ok = true;
+    Solver *s  = solver_new();
+    s->preprocess = false;
+    load_buffer(s, buf, len, &ok);
+    *vars    = s->num_vars;
+    *clauses = s->num_clauses;
+    for (int g = 0; g < s->num_amo; g++) {
+        long k = s->amo_start[g + 1] - s->amo_start[g];
+        *clauses += k * (k - 1) / 2;
+    }
+    solver_free(s);
+}
+
+static bool bench_one(const char *path, const BenchOpts *o, FILE *csv) {
+    size_t len;
+    bool   mapped;
+    char  *buf = load_file(path, &len, &mapped);
+    if (!buf) { fprintf(stderr, "Cannot open file: %s\n", path); return false; }
+
+    double *parse_t = malloc((size_t)o->runs * sizeof(double));
+    double *solve_t = malloc((size_t)o->runs * sizeof(double));
+    if (!parse_t || !solve_t) { fprintf(stderr, "OOM: bench samples\n"); exit(1); }
+
+    int  res = UNASSIGNED, N = 0, vars = 0;
+    long clauses = 0;
+    bool ok = true, stable = true;
+    for (int r = 0; ok && r < o->warmup + o->runs; r++) {
+        double  t0 = now_ms();
+        Solver *s  = solver_new();
+        s->restart_policy = o->restart_policy;
+        s->preprocess     = o->preprocess;
+        s->budget         = o->budget;
+        load_buffer(s, buf, len, &ok);
+        double  t1 = now_ms();
+        if (!ok) {
+            fprintf(stderr, "Malformed instance: %s\n", path);
+            solver_free(s);
+            break;
+        }
+        int rr = o->fast_path ? board_solve(s) : UNASSIGNED;
+        if (rr == UNASSIGNED) {
+            if (o->simplify) simplify(s);
+            rr = solve(s);
+        }
+        if (rr == SAT) extend_model(s);
+        double  t2 = now_ms();
+
+        if (r == 0)        { res = rr; N = s->N; }
+        else if (rr != res) stable = false;
+        if (r >= o->warmup) {
+            parse_t[r - o->warmup] = t1 - t0;
+            solve_t[r - o->warmup] = t2 - t1;
+        }
+        solver_free(s);
+    }
+    if (ok) bench_size(buf, len, &vars, &clauses);
+    if (mapped) munmap(buf, len);
+    else        free(buf);
+    if (!ok) { free(parse_t); free(solve_t); return false; }
+
+    /* a budget can cut some runs short and not others */
+    if (!stable) {
+        fprintf(stderr, "Runs disagree on the answer: %s\n", path);
+        res = UNKNOWN;
+    }
+    qsort(parse_t, (size_t)o->runs, sizeof(double), dbl_cmp);
+    qsort(solve_t, (size_t)o->runs, sizeof(double), dbl_cmp);
+    double pp[3], sp[3];
+    static const double ranks[3] = { 50, 95, 99 };
+    for (int i = 0; i < 3; i++) {
+        pp[i] = percentile(parse_t, o->runs, ranks[i]);
+        sp[i] = percentile(solve_t, o->runs, ranks[i]);
+    }
+    free(parse_t);
+    free(solve_t);
+
+    const char *answer = res == SAT ? "SAT" : res == UNSAT ? "UNSAT" : "UNKNOWN";
+    printf("%-7s %9.3f %9.3f %9.3f  %9.3f %9.3f %9.3f  %s\n", answer,
+           pp[0], pp[1], pp[2], sp[0], sp[1], sp[2], path);
+    fflush(stdout);
+
+    if (csv) {
+        char name[256], group[64];
+        bench_name(path, name, sizeof name);
+        /* a CNF without 'c SIZE' still says it in puzzle_fetcher.py's name */
+        if (N == 0 && sscanf(name, "sudoku_%dx", &N) != 1) N = 0;
+        bench_group(name, N, group, sizeof group);
+        /* benchmark.py's statuses; a run that hit its budget never finished */
+        const char *status = res == SAT ? "solved" :
+                             res == UNSAT ? "unsat/error" : "timeout";
+        fprintf(csv, "%s,%d,%s,%d,%ld,%.6f,", group, N, name, vars, clauses,
+                pp[0] / 1e3);
+        if (res == UNKNOWN) fprintf(csv, "inf");
+        else                fprintf(csv, "%.6f", sp[0] / 1e3);
+        fprintf(csv, ",nan,%s,skipped,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+                status, o->runs, pp[0], pp[1], pp[2], sp[0], sp[1], sp[2]);
+    }
+    return true;
+}
+
+static void bench_usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [options] file|directory|manifest ...\n"
+        "  --runs=N                      timed runs per instance (default: %d)\n"
+        "  --warmup=W                    untimed runs first (default: %d)\n"
+        "  --csv=FILE                    also write the results as CSV\n"
+        "  --restart=luby|glucose|none   restart policy (default: luby)\n"
+        "  --no-preprocess               encode puzzle files without applying\n"
+        "                                Sudoku rules first\n"
+        "  --no-simplify                 skip subsumption, variable elimination\n"
+        "                                and failed-literal probing\n"
+        "  --no-fast-path                time puzzle files up to 16x16 on CDCL\n"
+        "                                too, not on the bitboard\n"
+        "  --time-limit=SEC              give up on a run after SEC seconds\n"
+        "  --conflict-limit=N            ... or after N conflicts\n",
+        prog, BENCH_RUNS, BENCH_WARMUP);
+}
+
+int main(int argc, char **argv) {
+    BenchOpts o = { BENCH_RUNS, BENCH_WARMUP, RESTART_LUBY, true, true, true,
+                    { 0, 0, 0 } };
+    const char *csv_path = NULL;
+    Batch       b;
+    memset(&b, 0, sizeof b);
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (strncmp(a, "--runs=", 7) == 0) {
+            o.runs = atoi(a + 7);
+            if (o.runs < 1) { fprintf(stderr, "Bad run count: %s\n", a + 7); return 1; }
+        } else if (strncmp(a, "--warmup=", 9) == 0) {
+            o.warmup = atoi(a + 9);
+            if (o.warmup < 0) { fprintf(stderr, "Bad warmup count: %s\n", a + 9); return 1; }
+        } else if (strncmp(a, "--csv=", 6) == 0) {
+            csv_path = a + 6;
+        } else if (strncmp(a, "--restart=", 10) == 0) {
+            const char *p = a + 10;
+            if      (strcmp(p, "luby")    == 0) o.restart_policy = RESTART_LUBY;
+            else if (strcmp(p, "glucose") == 0) o.restart_policy = RESTART_GLUCOSE;
+            else if (strcmp(p, "none")    == 0) o.restart_policy = RESTART_NONE;
+            else { fprintf(stderr, "Unknown restart policy: %s\n", p); return 1; }
+        } else if (strcmp(a, "--no-preprocess") == 0) {
+            o.preprocess = false;
+        } else if (strcmp(a, "--no-simplify") == 0) {
+            o.simplify = false;
+        } else if (strcmp(a, "--no-fast-path") == 0) {
+            o.fast_path = false;
+        } else if (strncmp(a, "--time-limit=", 13) == 0) {
+            o.budget.time_ms = atof(a + 13) * 1e3;
+            if (o.budget.time_ms <= 0) {
+                fprintf(stderr, "Bad time limit: %s\n", a + 13); return 1;
+            }
+        } else if (strncmp(a, "--conflict-limit=", 17) == 0) {
+            o.budget.conflicts = atol(a + 17);
+            if (o.budget.conflicts <= 0) {
+                fprintf(stderr, "Bad conflict limit: %s\n", a + 17); return 1;
+            }
+        } else if (a[0] == '-' && a[1] == '-') {
+            fprintf(stderr, "Unknown option: %s\n", a);
+            bench_usage(argv[0]);
+            return 1;
+        } else {
+            struct stat st;
+            if (stat(a, &st) == 0 && S_ISREG(st.st_mode) &&
+                (has_suffix(a, ".cnf") || has_suffix(a, ".cnfb") ||
+                 has_suffix(a, ".txt")))
+                batch_push(&b, a);
+            else if (!batch_collect(&b, a))
+                return 1;
+        }
+    }
+    if (b.num_jobs == 0) { bench_usage(argv[0]); return 1; }
+
+    /* one at a time, in path order, so CSVs from two builds line up */
+    qsort(b.jobs, (size_t)b.num_jobs, sizeof(BatchJob), path_cmp);
+
+    FILE *csv = NULL;
+    if (csv_path) {
+        csv = fopen(csv_path, "w");
+        if (!csv) { fprintf(stderr, "Could not write %s\n", csv_path); return 1; }
+        fprintf(csv, "group,size,puzzle,cnf_vars,cnf_clauses,enc_time,sat_time,"
+                     "bt_time,sat_status,bt_status,runs,parse_p50_ms,"
+                     "parse_p95_ms,parse_p99_ms,solve_p50_ms,solve_p95_ms,"
+                     "solve_p99_ms\n");
+    }
+
+    printf("c %d run%s per instance after %d warmup, times in ms\n",
+           o.runs, o.runs == 1 ? "" : "s", o.warmup);
+    printf("%-7s %9s %9s %9s  %9s %9s %9s  %s\n", "result", "parse p50",
+           "p95", "p99", "solve p50", "p95", "p99", "instance");
+    int failed = 0;
+    for (int i = 0; i < b.num_jobs; i++) {
+        if (!bench_one(b.jobs[i].path, &o, csv)) failed++;
+        free(b.jobs[i].path);
+    }
+    free(b.jobs);
+    if (csv) fclose(csv);
+    return failed ? 1 : 0;
+}
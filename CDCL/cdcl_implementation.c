@@ -1,7 +1,26 @@
+#define _POSIX_C_SOURCE 200809L   /* mmap, posix_madvise under -std=c99 */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "ipasir.h"
 
 /*  ═══════════════════════════════════════════════════════════════════════════
     CDCL SAT Solver — compatible with the Kwon & Jain optimised φ' encoding
@@ -15,58 +34,242 @@
         c FIXED <r> <c> <v>       cell(r,c) was pre-assigned to v (not in CNF)
 
     All (r,c,v) values are 1-indexed.
+
+    A puzzle file from Puzzles/ (SIZE N, PUZZLE, N rows) may be given
+    instead of a CNF file; it is encoded in-process.  Singles and box-line
+    reductions are applied first, so only the cells they leave open reach
+    the solver (--no-preprocess keeps sudoku_to_cnf.py's numbering).
+
+    Build:  gcc -O2 -std=c11 -pthread -o cdcl cdcl_implementation.c
+            gcc -O2 -std=c11 -pthread -o cdcl_bench cdcl_bench.c  (timings)
     ═══════════════════════════════════════════════════════════════════════════ */
 
 /* ─── tuneable limits ─────────────────────────────────────────────────────── */
-#define MAX_VARS      500000
-#define MAX_TRAIL     500000
-#define MAX_LIT_BUF   256        /* max literals per clause in the input file */
-#define INIT_CLAUSES  65536      /* initial clause array capacity              */
+/* Nothing here is a hard cap: every buffer is sized from the 'p cnf' header */
+/* and grows if the input turns out to need more.                            */
+#define INIT_LIT_BUF  64         /* initial parser clause buffer, in literals  */
+#define INIT_ARENA    (1 << 20)  /* initial clause arena capacity, in ints     */
+#define VAR_DECAY     0.95       /* VSIDS: activity decay per conflict         */
+#define ACT_LIMIT     1e100      /* rescale all activities past this value     */
+#define LUBY_UNIT     100        /* conflicts per unit of the Luby sequence    */
+#define LBD_WINDOW    50         /* glucose: recent-LBD window size            */
+#define LBD_MARGIN    0.8        /* glucose: restart if recent*margin > global */
+#define CLA_DECAY     0.999      /* learned clause activity decay per conflict */
+#define CLA_LIMIT     1e20f      /* rescale clause activities past this value  */
+#define REDUCE_FIRST  2000       /* conflicts before the first DB reduction    */
+#define REDUCE_INC    300        /* each later interval is this much longer    */
+#define GLUE_LBD      2          /* learned clauses this good are never removed */
+#define CHRONO_DIST   100        /* longer backjumps only go back one level     */
+#define SHARE_LBD     3          /* portfolio: export learned clauses this good */
+#define SHARE_SIZE    16         /* ... and at most this long                   */
+#define SHARE_RING    (1 << 16)  /* export ring per worker, in ints             */
+#define SHARE_RECORD  (2 + SHARE_SIZE)  /* longest record: size, lbd, lits   */
+#define BOARD_MAX     16         /* largest N the bitboard fast path takes      */
+#define BOARD_NODES   1000       /* its search nodes before CDCL takes over     */
+
+/* ─── restart policies (--restart=...) ────────────────────────────────────── */
+#define RESTART_NONE     0
+#define RESTART_LUBY     1
+#define RESTART_GLUCOSE  2
 
 /* ─── result codes ────────────────────────────────────────────────────────── */
 #define SAT        10
 #define UNSAT      20
+#define UNKNOWN    0          /* interrupted (ipasir_solve's convention)      */
 #define UNASSIGNED -1
 
 /* ══════════════════════════════════════════════════════════════════════════ */
 /* Data structures                                                            */
 /* ══════════════════════════════════════════════════════════════════════════ */
 
+/* Clauses live back to back in one int arena and are referenced by their  */
+/* offset into it (a CRef); the literals follow the header inline.          */
+typedef int CRef;
+#define CREF_NONE  -1
+#define CREF_BINARY_CONFLICT  -2  /* a binary clause or group pair, see bin_confl */
+/* reasons below that stand for a binary clause, see binary_reason()       */
+
+/* what analyze() reads of a variable, in one place */
+typedef struct {
+    int  level;     /* decision level it was assigned at                    */
+    CRef reason;    /* forcing clause, or CREF_NONE for decisions           */
+} VarData;
+
+typedef struct {
+    int      size;
+    unsigned learnt  : 1;
+    unsigned deleted : 1;   /* removed by reduce_db(s), space not yet reclaimed */
+    unsigned reloced : 1;   /* moved by arena compaction: lits[0] = new CRef  */
+    unsigned lbd     : 29;
+    float    activity;      /* bumped when the clause takes part in analyze(s) */
+    int      lits[];        /* lits[0], lits[1] are the two watched literals  */
+} Clause;
+
+#define CLAUSE_WORDS(n)  ((int)(sizeof(Clause) / sizeof(int)) + (n))
+
+/* A watcher lives in the list of the literal it watches; the blocker is   */
+/* some other literal of the clause — if it is already true the clause is  */
+/* skipped without touching its literal array.                              */
+typedef struct {
+    CRef clause;
+    int  blocker;
+} Watcher;
+
+typedef struct {
+    Watcher *ws;
+    int      size;
+    int      cap;
+} WatchList;
+
+/* other literals of the binary clauses containing a literal, see bins */
 typedef struct {
     int *lits;
     int  size;
-} Clause;
+    int  cap;
+} BinList;
+
+/* at-most-one groups containing a literal */
+typedef struct {
+    int *ids;
+    int  size;
+    int  cap;
+} OccList;
+
+typedef struct { int r, c, v; } VarEntry;  /* all 1-indexed                  */
+
+/* resource limits for one solve(s), 0 = none; see budget_spent() */
+typedef struct {
+    double time_ms;
+    long   conflicts;
+    size_t mem_bytes;    /* clauses in use: live arena words plus list entries */
+} Budget;
 
 typedef struct {
     int num_vars;
     int num_clauses;
-    int clause_cap;
 
-    Clause *clauses;
+    int    *arena;     /* all clauses, header + literals, contiguous         */
+    size_t  arena_size;
+    size_t  arena_cap;
+    size_t  arena_wasted;  /* words held by deleted clauses                  */
 
-    int *assignment;   /* [0..num_vars]  1=true  0=false  UNASSIGNED        */
-    int *level_of;     /* decision level when var was assigned               */
-    int *reason;       /* forcing clause index, or -1 for decisions          */
+    CRef   *learnts;   /* learned clauses, candidates for reduce_db(s)        */
+    int     num_learnts;
+    int     learnts_cap;
+    float   cla_inc;   /* current clause bump amount                         */
+    long    next_reduce;   /* conflict count that triggers the next reduce   */
+    long    reductions;
+
+    int  var_cap;      /* per-variable arrays hold var_cap + 1 entries       */
+
+    signed char *value; /* [watch_index(lit)]  1=true  0=false  UNASSIGNED   */
+    VarData     *vardata; /* [var] level and reason while var is assigned    */
 
     int *trail;        /* literals in assignment order                       */
     int  trail_top;
+    int  qhead;        /* trail[qhead..trail_top) still to be propagated     */
+    int *trail_lim;    /* [l] = trail_top when level l + 1 was opened        */
+
+    WatchList *watches; /* [watch_index(lit)] clauses watching lit           */
+    BinList   *bins;    /* [watch_index(lit)] x for each binary (lit | x)    */
+    int        bin_expl[CLAUSE_WORDS(2)];   /* explanations handed to analyze */
+    int        bin_confl[CLAUSE_WORDS(2)];
+
+    /* at-most-one groups, propagated without their pairwise clauses */
+    int     *amo_lits;  /* groups back to back                               */
+    int      amo_len, amo_lits_cap;
+    int     *amo_start; /* group g is amo_lits[amo_start[g]..amo_start[g+1]) */
+    int      amo_start_len, amo_start_cap;
+    int      num_amo;
+    OccList *amo_occ;   /* [watch_index(lit)] groups containing lit          */
+
+    double *activity;  /* VSIDS score per variable                           */
+    double  var_inc;   /* current bump amount (grows by 1/VAR_DECAY)         */
+    int    *heap;      /* binary max-heap of variables keyed on activity     */
+    int    *heap_pos;  /* heap_pos[var] = index in heap, or -1 if absent     */
+    int     heap_size;
+
+    char   *phase;     /* saved polarity per variable, reused by decide(s)    */
+    char   *eliminated;/* removed by simplify(s), valued by extend_model(s)   */
+    int    *elim_stack;/* clauses of eliminated variables, see elim_push()   */
+    int     elim_len, elim_cap;
+
+    int    *lvl_stamp; /* [level] = stamp, for counting distinct levels      */
+    int     lvl_cap;   /* levels can outnumber variables under assumptions;  */
+                       /* trail_lim has the same capacity                    */
+    int     cur_stamp;
+
+    /* conflict analysis scratch, one slot per variable */
+    int    *seen;      /* valid only where gen_of[v] == cur_gen              */
+    int    *gen_of;
+    int     cur_gen;
+    int    *learned;   /* learned clause under construction                  */
+    int     learned_len;
+    int    *an_stack;  /* lit_redundant(s) DFS stack                          */
+    int    *an_toclear;/* marks to undo when a redundancy probe fails        */
+
+    /* restart bookkeeping */
+    int     restart_policy;
+    long    conflicts;
+    long    restarts;
+    long    conflicts_since_restart;
+    long    chrono_backtracks;        /* backjumps cut short by CHRONO_DIST */
+    long    reused_levels;            /* decision levels restarts kept      */
+    int     last_lbd;                 /* LBD of the latest learned clause   */
+    int     lbd_queue[LBD_WINDOW];    /* ring buffer of recent learned LBDs */
+    int     lbd_queue_len;
+    int     lbd_queue_head;
+    long    lbd_queue_sum;
+    double  lbd_total;                /* sum of all learned LBDs            */
+
+    /* search counters, reported by --stats */
+    long    decisions;
+    long    propagations;   /* literals taken off the trail by propagate(s) */
+    long    learned_total;  /* every clause analyze(s) produced              */
+    long    learned_lits;
 
     int level;         /* current decision level                             */
-} Solver;
+    bool ok;           /* false once the clauses alone are unsatisfiable     */
+    bool preprocess;   /* apply Sudoku rules before encoding a puzzle file   */
 
-/* ─── Sudoku metadata, read from CNF comments ─────────────────────────────── */
-typedef struct { int r, c, v; } VarEntry;  /* all 1-indexed                  */
+    /* incremental interface (ipasir_*), see the end of the file */
+    int    *add_buf;   /* clause being built by ipasir_add()                 */
+    int     add_len, add_cap;
+    int    *assumps;   /* assumptions for the next solve, assumps[i] is      */
+    int     num_assumps, assumps_cap;   /* decided at level i + 1          */
+    int    *failed;    /* assumptions behind the last UNSAT answer            */
+    int     num_failed, failed_cap;
+    void   *term_data;
+    int   (*terminate)(void *);
+    void   *learn_data;
+    int     learn_max;
+    void  (*learn)(void *, int32_t *);
 
-static int       N             = 0;
-static VarEntry *var_info      = NULL;     /* var_info[dimacs_var] -> (r,c,v) */
-static int       var_info_cap  = 0;
+    Budget  budget;
+    size_t  list_bytes;     /* held by watcher and binary list entries       */
+    const char *limit_hit;  /* the limit that stopped the last solve, or NULL */
 
-/* fixed cells stored as flat int triples: [r0, c0, v0, r1, c1, v1, ...]     */
-static int *fixed_flat  = NULL;
-static int  fixed_count = 0;
-static int  fixed_cap   = 0;
+    /* what simplify(s) removed */
+    long    simp_eliminated, simp_subsumed, simp_strengthened, simp_failed;
 
-static Solver solver;
+    /* clause sharing between portfolio workers, NULL when running alone */
+    struct Share *share;
+    int     share_id;
+    long    shared_out, shared_in;
+
+    /* Sudoku metadata, read from CNF comments */
+    int       N;
+    VarEntry *var_info;      /* var_info[dimacs_var] -> (r,c,v)              */
+    int       var_info_cap;
+    int      *fixed_flat;    /* fixed cells as flat triples [r0,c0,v0,r1,...] */
+    int       fixed_count;
+    int       fixed_cap;
+
+    /* a puzzle file's grid after the Sudoku rules, for board_solve() */
+    unsigned char board[BOARD_MAX * BOARD_MAX];
+    int       board_n;       /* its N, 0 if there is none or N > BOARD_MAX   */
+    long      board_nodes;   /* search nodes board_solve() visited           */
+} Solver;
 
 /* ══════════════════════════════════════════════════════════════════════════ */
 /* Utility                                                                    */
@@ -74,404 +277,5356 @@ static Solver solver;
 
 static inline int absval(int x) { return x > 0 ? x : -x; }
 
-static inline int lit_value(int lit) {
-    int var = absval(lit);
-    int val = solver.assignment[var];
-    if (val == UNASSIGNED) return UNASSIGNED;
-    return (lit > 0) ? val : !val;
+/* watch lists are indexed 2*var for +var and 2*var+1 for -var             */
+static inline int watch_index(int lit) {
+    return 2 * absval(lit) + (lit < 0);
 }
 
-/* ══════════════════════════════════════════════════════════════════════════ */
-/* Clause management (dynamic)                                                */
-/* ══════════════════════════════════════════════════════════════════════════ */
+static inline int index_lit(int idx) {
+    return (idx & 1) ? -(idx / 2) : idx / 2;
+}
+
+static inline Clause *clause_at(Solver *s, CRef cr) {
+    return (Clause *)(s->arena + cr);
+}
+
+/* both signs of a variable are stored, so a literal's value is one load */
+static inline int lit_value(const Solver *s, int lit) {
+    return s->value[watch_index(lit)];
+}
+
+static inline int var_value(const Solver *s, int var) {
+    return s->value[2 * var];
+}
+
+static inline void set_var_value(Solver *s, int var, int val) {
+    s->value[2 * var]     = (signed char)val;
+    s->value[2 * var + 1] = (signed char)(val == UNASSIGNED ? val : !val);
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
 
-static void add_clause(int *lits, int size) {
-    if (solver.num_clauses >= solver.clause_cap) {
-        solver.clause_cap *= 2;
-        solver.clauses = realloc(solver.clauses,
-                                 (size_t)solver.clause_cap * sizeof(Clause));
-        if (!solver.clauses) { fprintf(stderr, "OOM: clauses\n"); exit(1); }
+static void push_int(int **buf, int *len, int *cap, int x, const char *what) {
+    if (*len >= *cap) {
+        *cap = *cap ? *cap * 2 : 64;
+        *buf = realloc(*buf, (size_t)*cap * sizeof(int));
+        if (!*buf) { fprintf(stderr, "OOM: %s\n", what); exit(1); }
     }
-    Clause *c  = &solver.clauses[solver.num_clauses++];
-    c->size    = size;
-    c->lits    = malloc((size_t)size * sizeof(int));
-    if (!c->lits) { fprintf(stderr, "OOM: clause lits\n"); exit(1); }
-    memcpy(c->lits, lits, (size_t)size * sizeof(int));
+    (*buf)[(*len)++] = x;
 }
 
 /* ══════════════════════════════════════════════════════════════════════════ */
 /* Assignment                                                                 */
 /* ══════════════════════════════════════════════════════════════════════════ */
 
-static void assign(int lit, int level, int reason_clause) {
-    int var = absval(lit);
-    solver.assignment[var] = (lit > 0) ? 1 : 0;
-    solver.level_of[var]   = level;
-    solver.reason[var]     = reason_clause;
-    solver.trail[solver.trail_top++] = lit;
+static void assign(Solver *s, int lit, int level, CRef reason_clause) {
+    int idx = watch_index(lit);
+    s->value[idx]     = 1;
+    s->value[idx ^ 1] = 0;
+    s->vardata[idx >> 1] = (VarData){ level, reason_clause };
+    s->trail[s->trail_top++] = lit;
+}
+
+/* room for decision levels 0..levels-1 in lvl_stamp and trail_lim */
+static void reserve_levels(Solver *s, int levels) {
+    if (levels <= s->lvl_cap) return;
+    s->lvl_stamp = realloc(s->lvl_stamp, (size_t)levels * sizeof(int));
+    s->trail_lim = realloc(s->trail_lim, (size_t)levels * sizeof(int));
+    if (!s->lvl_stamp || !s->trail_lim) {
+        fprintf(stderr, "OOM: decision levels\n"); exit(1);
+    }
+    memset(s->lvl_stamp + s->lvl_cap, 0,
+           (size_t)(levels - s->lvl_cap) * sizeof(int));
+    s->lvl_cap = levels;
+}
+
+/* opens level s->level + 1 at the end of the trail */
+static void new_level(Solver *s) {
+    if (s->level + 1 >= s->lvl_cap) reserve_levels(s, 2 * s->level + 2);
+    s->trail_lim[s->level++] = s->trail_top;
 }
 
 /* ══════════════════════════════════════════════════════════════════════════ */
-/* Unit propagation                                                           */
-/* Returns first conflict clause index, or -1.                               */
+/* Binary clauses                                                             */
+/*                                                                            */
+/*  A binary clause (a | b) is not kept in the arena: b is appended to       */
+/*  bins[watch_index(a)] and a to bins[watch_index(b)], and propagate()      */
+/*  runs through the list of a newly false literal before its watchers.     */
+/*  What a binary implies gets a tagged reason instead of a clause;          */
+/*  reason_clause() writes the explanation into a scratch clause the moment  */
+/*  analyze() asks for it.  Learned binaries are kept for good.              */
 /* ══════════════════════════════════════════════════════════════════════════ */
 
-static int propagate(void) {
-    bool changed = true;
-    while (changed) {
-        changed = false;
-        for (int i = 0; i < solver.num_clauses; i++) {
-            Clause *c = &solver.clauses[i];
-            int unassigned = 0, last_lit = 0;
-            bool satisfied = false;
+/* reason of a literal implied by lit alone, through a clause (-lit | x) */
+static inline CRef binary_reason(int lit) { return -3 - watch_index(lit); }
 
-            for (int j = 0; j < c->size; j++) {
-                int val = lit_value(c->lits[j]);
-                if (val == 1)          { satisfied = true; break; }
-                if (val == UNASSIGNED) { unassigned++; last_lit = c->lits[j]; }
-            }
-            if (satisfied)     continue;
-            if (unassigned == 0) return i;        /* conflict               */
-            if (unassigned == 1) {
-                assign(last_lit, solver.level, i);
-                changed = true;
-            }
-        }
+/*
+ * The clause behind a reason or conflict.  Scratch clauses are only valid
+ * until the next call, which is all analyze() and its helpers need.
+ */
+static Clause *reason_clause(Solver *s, CRef cr, int var) {
+    if (cr >= 0) return clause_at(s, cr);
+    if (cr == CREF_BINARY_CONFLICT) return (Clause *)s->bin_confl;
+    Clause *c = (Clause *)s->bin_expl;
+    c->lits[0] = var_value(s, var) ? var : -var;
+    c->lits[1] = -index_lit(-3 - cr);
+    return c;
+}
+
+static void bin_push(Solver *s, BinList *bl, int lit) {
+    if (bl->size >= bl->cap) {
+        bl->cap  = bl->cap ? bl->cap * 2 : 4;
+        bl->lits = realloc(bl->lits, (size_t)bl->cap * sizeof(int));
+        if (!bl->lits) { fprintf(stderr, "OOM: binary clauses\n"); exit(1); }
     }
-    return -1;
+    bl->lits[bl->size++] = lit;
+    s->list_bytes += sizeof(int);
 }
 
-/* ══════════════════════════════════════════════════════════════════════════ */
-/* Decision — first unassigned variable, positive polarity                   */
-/* ══════════════════════════════════════════════════════════════════════════ */
+/* each binary clause sits in two lists; this counts it once */
+static int binaries_count(const Solver *s) {
+    int n = 0;
+    for (int w = 2; w < 2 * s->num_vars + 2; w++)
+        for (int k = 0; k < s->bins[w].size; k++)
+            n += w < watch_index(s->bins[w].lits[k]);
+    return n;
+}
 
-static int decide(void) {
-    for (int i = 1; i <= solver.num_vars; i++)
-        if (solver.assignment[i] == UNASSIGNED)
-            return i;
-    return 0;
+/* the conflict of a binary clause whose literals are both false */
+static CRef binary_conflict(Solver *s, int a, int b) {
+    Clause *c = (Clause *)s->bin_confl;
+    c->lits[0] = a;
+    c->lits[1] = b;
+    return CREF_BINARY_CONFLICT;
 }
 
 /* ══════════════════════════════════════════════════════════════════════════ */
-/* Backtrack to given level                                                   */
+/* Clause management (dynamic)                                                */
 /* ══════════════════════════════════════════════════════════════════════════ */
 
-static void backtrack(int level) {
-    while (solver.trail_top > 0) {
-        int lit = solver.trail[solver.trail_top - 1];
-        int var = absval(lit);
-        if (solver.level_of[var] <= level) break;
-        solver.assignment[var] = UNASSIGNED;
-        solver.reason[var]     = -1;
-        solver.level_of[var]   = 0;
-        solver.trail_top--;
+static void watch_push(Solver *s, int lit, CRef clause, int blocker) {
+    WatchList *wl = &s->watches[watch_index(lit)];
+    if (wl->size >= wl->cap) {
+        wl->cap = wl->cap ? wl->cap * 2 : 4;
+        wl->ws  = realloc(wl->ws, (size_t)wl->cap * sizeof(Watcher));
+        if (!wl->ws) { fprintf(stderr, "OOM: watch list\n"); exit(1); }
     }
-    solver.level = level;
+    wl->ws[wl->size++] = (Watcher){clause, blocker};
+    s->list_bytes += sizeof(Watcher);
 }
 
-/* ══════════════════════════════════════════════════════════════════════════ */
-/* First-UIP conflict analysis                                                */
-/* Adds learned clause, returns backtrack level.                             */
-/* ══════════════════════════════════════════════════════════════════════════ */
+static void arena_reserve(Solver *s, size_t words) {
+    if (words <= s->arena_cap) return;
+    size_t new_cap = s->arena_cap ? s->arena_cap : INIT_ARENA;
+    while (new_cap < words) new_cap *= 2;
+    s->arena = realloc(s->arena, new_cap * sizeof(int));
+    if (!s->arena) { fprintf(stderr, "OOM: clause arena\n"); exit(1); }
+    s->arena_cap = new_cap;
+}
 
-static int analyze(int conflict_clause) {
-    /*
-     * Use a generation counter instead of memset to clear seen[]:
-     *   gen_of[v] == cur_gen  means  seen[v] is active.
-     */
-    static int seen[MAX_VARS + 1];
-    static int gen_of[MAX_VARS + 1];
-    static int cur_gen = 0;
-    cur_gen++;
+/* returns the tagged reason lits[0] gets from the clause */
+static CRef add_binary(Solver *s, const int *lits, bool learnt) {
+    int a = lits[0], b = lits[1];
+    bin_push(s, &s->bins[watch_index(a)], b);
+    bin_push(s, &s->bins[watch_index(b)], a);
+    s->num_clauses++;
+    if (!learnt) {
+        int va = lit_value(s, a), vb = lit_value(s, b);
+        if      (va == 0 && vb == 0)          s->ok = false;
+        else if (va == 0 && vb == UNASSIGNED) assign(s, b, 0, binary_reason(-a));
+        else if (vb == 0 && va == UNASSIGNED) assign(s, a, 0, binary_reason(-b));
+    }
+    return binary_reason(-b);
+}
 
-    static int learned[MAX_LIT_BUF];
-    int size    = 0;
-    int counter = 0;
-    int idx     = solver.trail_top - 1;
+/*
+ * Growing the arena may move it, so Clause pointers do not survive a call.
+ * Binary clauses do not go into the arena; add_binary() says what their
+ * CRef is.
+ *
+ * Original clauses must be added at level 0.  Their literals already false
+ * there are moved behind the watches, so a clause added between two solves
+ * is watched correctly; one that is left with a single candidate literal is
+ * asserted on the spot (unit clauses are never watched), and one with none
+ * makes the instance unsatisfiable.
+ */
+static CRef add_clause(Solver *s, const int *lits, int size, bool learnt) {
+    if (size == 2 && lits[0] == lits[1]) size = 1;
+    if (size == 2) return add_binary(s, lits, learnt);
+    arena_reserve(s, s->arena_size + (size_t)CLAUSE_WORDS(size));
+    CRef    cr = (CRef)s->arena_size;
+    Clause *c  = clause_at(s, cr);
+    c->size     = size;
+    c->learnt   = learnt;
+    c->deleted  = 0;
+    c->reloced  = 0;
+    c->lbd      = 0;
+    c->activity = 0.0f;
+    memcpy(c->lits, lits, (size_t)size * sizeof(int));
+    s->arena_size += (size_t)CLAUSE_WORDS(size);
+    s->num_clauses++;
 
-    /* initialise with conflict clause */
-    Clause *c = &solver.clauses[conflict_clause];
-    for (int i = 0; i < c->size; i++) {
-        int v = absval(c->lits[i]);
-        if (gen_of[v] != cur_gen) {
-            gen_of[v] = cur_gen; seen[v] = 1;
-            if (solver.level_of[v] == solver.level) counter++;
+    int live = 2;
+    if (!learnt) {
+        live = 0;
+        for (int i = 0; i < size && live < 2; i++) {
+            if (lit_value(s, c->lits[i]) == 0) continue;
+            int t = c->lits[live]; c->lits[live++] = c->lits[i]; c->lits[i] = t;
         }
+        if (live == 0)
+            s->ok = false;
+        else if (live == 1 && lit_value(s, c->lits[0]) == UNASSIGNED)
+            assign(s, c->lits[0], 0, cr);
+    }
+    if (size >= 2) {
+        watch_push(s, c->lits[0], cr, c->lits[1]);
+        watch_push(s, c->lits[1], cr, c->lits[0]);
     }
 
-    /* resolve until one literal at current level remains (the UIP) */
-    while (counter > 1) {
-        while (gen_of[absval(solver.trail[idx])] != cur_gen ||
-               !seen[absval(solver.trail[idx])])
-            idx--;
-
-        int lit = solver.trail[idx--];
-        int v   = absval(lit);
-        seen[v] = 0;
-        counter--;
-
-        int rc = solver.reason[v];
-        if (rc < 0) continue;
-
-        Clause *rc_c = &solver.clauses[rc];
-        for (int i = 0; i < rc_c->size; i++) {
-            int vv = absval(rc_c->lits[i]);
-            if (gen_of[vv] != cur_gen) {
-                gen_of[vv] = cur_gen; seen[vv] = 1;
-                if (solver.level_of[vv] == solver.level) counter++;
-            }
+    if (learnt) {
+        if (s->num_learnts >= s->learnts_cap) {
+            s->learnts_cap = s->learnts_cap ? s->learnts_cap * 2 : 1024;
+            s->learnts = realloc(s->learnts,
+                                 (size_t)s->learnts_cap * sizeof(CRef));
+            if (!s->learnts) { fprintf(stderr, "OOM: learnts\n"); exit(1); }
         }
+        s->learnts[s->num_learnts++] = cr;
     }
+    return cr;
+}
 
-    /* build learned clause */
-    int backtrack_level = 0;
-    for (int v = 1; v <= solver.num_vars; v++) {
-        if (gen_of[v] != cur_gen || !seen[v]) continue;
-        int lit = (solver.assignment[v] == 1) ? -v : v;
-        if (size < MAX_LIT_BUF) learned[size++] = lit;
-        if (solver.level_of[v] != solver.level &&
-            solver.level_of[v] > backtrack_level)
-            backtrack_level = solver.level_of[v];
+static void cla_bump(Solver *s, Clause *c) {
+    if ((c->activity += s->cla_inc) > CLA_LIMIT) {
+        for (int i = 0; i < s->num_learnts; i++)
+            clause_at(s, s->learnts[i])->activity *= 1.0f / CLA_LIMIT;
+        s->cla_inc *= 1.0f / CLA_LIMIT;
     }
+}
 
-    add_clause(learned, size);
-    return backtrack_level;
+static inline void cla_decay(Solver *s) {
+    s->cla_inc *= 1.0f / (float)CLA_DECAY;
 }
 
 /* ══════════════════════════════════════════════════════════════════════════ */
-/* CDCL main loop                                                             */
+/* At-most-one groups                                                         */
+/*                                                                            */
+/*  A group stands for all the binary clauses (-a | -b) between its          */
+/*  literals, which on a large Sudoku are most of the instance.  When a      */
+/*  member becomes true, propagate() walks its groups and falsifies the      */
+/*  rest.  The implied literals get the same tagged reasons as binary        */
+/*  clauses do.                                                               */
 /* ══════════════════════════════════════════════════════════════════════════ */
 
-static int solve(void) {
-    solver.level = 0;
-    for (;;) {
-        int conflict = propagate();
-        if (conflict >= 0) {
-            if (solver.level == 0) return UNSAT;
-            int bt = analyze(conflict);
-            backtrack(bt);
-            continue;
-        }
-        int var = decide();
-        if (var == 0) return SAT;
-        solver.level++;
-        assign(var, solver.level, -1);
+static void occ_push(OccList *ol, int id) {
+    if (ol->size >= ol->cap) {
+        ol->cap = ol->cap ? ol->cap * 2 : 4;
+        ol->ids = realloc(ol->ids, (size_t)ol->cap * sizeof(int));
+        if (!ol->ids) { fprintf(stderr, "OOM: amo occurrences\n"); exit(1); }
     }
+    ol->ids[ol->size++] = id;
 }
 
-/* ══════════════════════════════════════════════════════════════════════════ */
-/* DIMACS parser — reads clause lines AND c SIZE / c MAP / c FIXED comments  */
-/* ══════════════════════════════════════════════════════════════════════════ */
+/*
+ * Adds an at-most-one group; like add_clause() it must be called at level
+ * 0.  Members already false are left out, and one that is already true
+ * falsifies the others on the spot.
+ */
+static void add_amo(Solver *s, const int *lits, int size) {
+    if (s->amo_start_len == 0)
+        push_int(&s->amo_start, &s->amo_start_len, &s->amo_start_cap, 0,
+                 "amo groups");
+    int true_lit = 0, first = s->amo_len;
+    for (int i = 0; i < size; i++) {
+        int v = lit_value(s, lits[i]);
+        if (v == 0) continue;
+        if (v == 1) {
+            if (true_lit && true_lit != lits[i]) { s->ok = false; return; }
+            true_lit = lits[i];
+        }
+        push_int(&s->amo_lits, &s->amo_len, &s->amo_lits_cap, lits[i],
+                 "amo groups");
+    }
+    if (true_lit) {
+        for (int i = first; i < s->amo_len; i++)
+            if (s->amo_lits[i] != true_lit)
+                assign(s, -s->amo_lits[i], 0, binary_reason(true_lit));
+        s->amo_len = first;
+        return;
+    }
+    if (s->amo_len - first < 2) { s->amo_len = first; return; }
 
-static void ensure_var_info(int var) {
-    if (var < var_info_cap) return;
-    int new_cap = var_info_cap ? var_info_cap * 2 : 1024;
-    while (new_cap <= var) new_cap *= 2;
-    var_info = realloc(var_info, (size_t)new_cap * sizeof(VarEntry));
-    if (!var_info) { fprintf(stderr, "OOM: var_info\n"); exit(1); }
-    memset(var_info + var_info_cap, 0,
-           (size_t)(new_cap - var_info_cap) * sizeof(VarEntry));
-    var_info_cap = new_cap;
+    for (int i = first; i < s->amo_len; i++)
+        occ_push(&s->amo_occ[watch_index(s->amo_lits[i])], s->num_amo);
+    push_int(&s->amo_start, &s->amo_start_len, &s->amo_start_cap, s->amo_len,
+             "amo groups");
+    s->num_amo++;
 }
 
-static void push_fixed(int r, int c, int v) {
-    if (fixed_count * 3 + 3 > fixed_cap) {
-        fixed_cap = fixed_cap ? fixed_cap * 2 : 192;
-        fixed_flat = realloc(fixed_flat, (size_t)fixed_cap * sizeof(int));
-        if (!fixed_flat) { fprintf(stderr, "OOM: fixed_flat\n"); exit(1); }
+/* lit has just become true at level lv: falsify the rest of its groups */
+static CRef amo_propagate(Solver *s, int lit, int lv) {
+    OccList *ol = &s->amo_occ[watch_index(lit)];
+    for (int k = 0; k < ol->size; k++) {
+        int g = ol->ids[k];
+        for (int i = s->amo_start[g]; i < s->amo_start[g + 1]; i++) {
+            int q = s->amo_lits[i];
+            if (q == lit) continue;
+            int v = lit_value(s, q);
+            if (v == UNASSIGNED) assign(s, -q, lv, binary_reason(lit));
+            else if (v == 1)     return binary_conflict(s, -lit, -q);
+        }
     }
-    fixed_flat[fixed_count * 3 + 0] = r;
-    fixed_flat[fixed_count * 3 + 1] = c;
-    fixed_flat[fixed_count * 3 + 2] = v;
-    fixed_count++;
+    return CREF_NONE;
 }
 
-static void parse_dimacs(FILE *f) {
-    char line[8192];
-    int  lits[MAX_LIT_BUF];
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Unit propagation — two watched literals                                    */
+/*                                                                            */
+/*  Every arena clause of size >= 3 watches lits[0] and lits[1].  When a      */
+/*  literal becomes false only the clauses watching it are visited: each one  */
+/*  either finds a replacement watch, becomes unit on its other watch, or is  */
+/*  a conflict.  The trail itself is the propagation queue.  The binary       */
+/*  clauses of the newly false literal, then the at-most-one groups of the    */
+/*  newly true one, are handled first.                                        */
+/*                                                                            */
+/*  An implied literal gets the highest level among the rest of its reason,   */
+/*  not simply the current one, so a chronological backtrack keeps it as      */
+/*  long as its reason holds.  That level is the false literal's own unless   */
+/*  it is an older literal propagated again after such a backtrack.           */
+/*                                                                            */
+/* Returns the first conflict clause, or CREF_NONE.                          */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+static CRef propagate(Solver *s) {
+    while (s->qhead < s->trail_top) {
+        int false_lit = -s->trail[s->qhead++];
+        int lv        = s->vardata[absval(false_lit)].level;
+        s->propagations++;
+        BinList *bl = &s->bins[watch_index(false_lit)];
+        for (int k = 0; k < bl->size; k++) {
+            int q = bl->lits[k], v = lit_value(s, q);
+            if (v == 1) continue;
+            if (v == UNASSIGNED) {
+                assign(s, q, lv, binary_reason(-false_lit));
+                continue;
+            }
+            s->qhead = s->trail_top;
+            return binary_conflict(s, false_lit, q);
+        }
+        if (s->amo_occ[watch_index(-false_lit)].size > 0) {
+            CRef confl = amo_propagate(s, -false_lit, lv);
+            if (confl != CREF_NONE) { s->qhead = s->trail_top; return confl; }
+        }
+        WatchList *wl = &s->watches[watch_index(false_lit)];
+        Watcher   *i  = wl->ws, *j = wl->ws, *end = wl->ws + wl->size;
 
-    solver.clause_cap  = INIT_CLAUSES;
-    solver.clauses     = malloc((size_t)INIT_CLAUSES * sizeof(Clause));
-    solver.num_clauses = 0;
+        while (i < end) {
+            if (lit_value(s, i->blocker) == 1) { *j++ = *i++; continue; }
 
-    while (fgets(line, sizeof(line), f)) {
+            Clause *c    = clause_at(s, i->clause);
+            int    *lits = c->lits;
 
-        /* ── comment line ──────────────────────────────────────────────── */
-        if (line[0] == 'c') {
-            int vi, r, c, v;
-            if      (sscanf(line, "c SIZE %d",           &v)          == 1) { N = v; }
-            else if (sscanf(line, "c MAP %d %d %d %d",  &vi,&r,&c,&v) == 4) {
-                ensure_var_info(vi);
-                var_info[vi] = (VarEntry){r, c, v};
-            }
-            else if (sscanf(line, "c FIXED %d %d %d",   &r,&c,&v)    == 3) {
-                push_fixed(r, c, v);
+            /* make sure the false literal sits in lits[1] */
+            if (lits[0] == false_lit) { lits[0] = lits[1]; lits[1] = false_lit; }
+
+            /* other watch already true: keep watching, refresh blocker */
+            Watcher w = { i->clause, lits[0] };
+            i++;
+            if (lit_value(s, lits[0]) == 1) { *j++ = w; continue; }
+
+            /* look for a new literal to watch */
+            bool moved = false;
+            for (int k = 2; k < c->size; k++) {
+                if (lit_value(s, lits[k]) != 0) {
+                    lits[1] = lits[k]; lits[k] = false_lit;
+                    watch_push(s, lits[1], w.clause, lits[0]);
+                    moved = true;
+                    break;
+                }
             }
-            continue;
-        }
+            if (moved) continue;
 
-        /* ── problem line ──────────────────────────────────────────────── */
-        if (line[0] == 'p') {
-            int dv, dc;
-            sscanf(line, "p cnf %d %d", &dv, &dc);
-            solver.num_vars   = dv;
-            solver.assignment = malloc((size_t)(dv + 1) * sizeof(int));
-            solver.level_of   = calloc((size_t)(dv + 1), sizeof(int));
-            solver.reason     = malloc((size_t)(dv + 1) * sizeof(int));
-            solver.trail      = malloc((size_t)(dv + 1) * sizeof(int));
-            if (!solver.assignment||!solver.level_of||
-                !solver.reason    ||!solver.trail) {
-                fprintf(stderr,"OOM: solver arrays\n"); exit(1);
-            }
-            for (int i = 0; i <= dv; i++) {
-                solver.assignment[i] = UNASSIGNED;
-                solver.reason[i]     = -1;
+            /* clause is unit or conflicting under the current assignment */
+            *j++ = w;
+            if (lit_value(s, lits[0]) == 0) {
+                while (i < end) *j++ = *i++;
+                s->list_bytes -= (size_t)(wl->size - (j - wl->ws)) * sizeof(Watcher);
+                wl->size     = (int)(j - wl->ws);
+                s->qhead = s->trail_top;
+                return w.clause;
             }
-            continue;
+            int at = lv;
+            if (at < s->level)
+                for (int k = 2; k < c->size; k++) {
+                    int l = s->vardata[absval(lits[k])].level;
+                    if (l > at) at = l;
+                }
+            assign(s, lits[0], at, w.clause);
         }
+        s->list_bytes -= (size_t)(wl->size - (j - wl->ws)) * sizeof(Watcher);
+        wl->size = (int)(j - wl->ws);
+    }
+    return CREF_NONE;
+}
 
-        /* ── clause line ───────────────────────────────────────────────── */
-        int count = 0;
-        char *tok = strtok(line, " \t\n");
-        while (tok) {
-            int lit = atoi(tok);
-            if (lit == 0) break;
-            if (count < MAX_LIT_BUF) lits[count++] = lit;
-            tok = strtok(NULL, " \t\n");
-        }
-        if (count > 0) add_clause(lits, count);
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Variable order heap (VSIDS)                                                */
+/*                                                                            */
+/*  Unassigned variables sit in a binary max-heap keyed on activity.          */
+/*  analyze() bumps every variable it touches; instead of decaying all        */
+/*  scores after each conflict the bump itself grows by 1/VAR_DECAY, which    */
+/*  has the same relative effect (EVSIDS).  Assigned variables may linger in  */
+/*  the heap and are skipped lazily by decide().                              */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+/* ties go to the lower index, so until conflicts separate the scores the  */
+/* search follows the encoder's row-major cell order like the old scan     */
+static inline bool heap_before(Solver *s, int a, int b) {
+    double aa = s->activity[a], ab = s->activity[b];
+    return aa > ab || (aa == ab && a < b);
+}
+
+static void heap_up(Solver *s, int i) {
+    int v = s->heap[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!heap_before(s, v, s->heap[parent])) break;
+        s->heap[i] = s->heap[parent];
+        s->heap_pos[s->heap[i]] = i;
+        i = parent;
+    }
+    s->heap[i]  = v;
+    s->heap_pos[v] = i;
+}
+
+static void heap_down(Solver *s, int i) {
+    int v = s->heap[i];
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= s->heap_size) break;
+        if (child + 1 < s->heap_size &&
+            heap_before(s, s->heap[child + 1], s->heap[child]))
+            child++;
+        if (!heap_before(s, s->heap[child], v)) break;
+        s->heap[i] = s->heap[child];
+        s->heap_pos[s->heap[i]] = i;
+        i = child;
+    }
+    s->heap[i]  = v;
+    s->heap_pos[v] = i;
+}
+
+static void heap_insert(Solver *s, int var) {
+    if (s->heap_pos[var] >= 0) return;
+    s->heap[s->heap_size] = var;
+    heap_up(s, s->heap_size++);
+}
+
+static int heap_pop(Solver *s) {
+    int top = s->heap[0];
+    s->heap_pos[top] = -1;
+    if (--s->heap_size > 0) {
+        s->heap[0] = s->heap[s->heap_size];
+        heap_down(s, 0);
+    }
+    return top;
+}
+
+static void var_bump(Solver *s, int var) {
+    if ((s->activity[var] += s->var_inc) > ACT_LIMIT) {
+        for (int i = 1; i <= s->num_vars; i++)
+            s->activity[i] *= 1.0 / ACT_LIMIT;
+        s->var_inc *= 1.0 / ACT_LIMIT;
     }
+    if (s->heap_pos[var] >= 0) heap_up(s, s->heap_pos[var]);
+}
+
+static inline void var_decay(Solver *s) {
+    s->var_inc *= 1.0 / VAR_DECAY;
 }
 
 /* ══════════════════════════════════════════════════════════════════════════ */
-/* Print DIMACS-style result                                                  */
+/* Decision — highest-activity unassigned variable, saved polarity           */
+/*                                                                            */
+/*  Returns the literal to assign, or 0 when every variable is assigned.     */
+/*  Phases start positive and remember the last value each variable held,   */
+/*  so a restart climbs straight back towards the abandoned assignment.      */
 /* ══════════════════════════════════════════════════════════════════════════ */
 
-static void print_result(int res) {
-    if (res == SAT) {
-        printf("SAT\nv ");
-        for (int i = 1; i <= solver.num_vars; i++) {
-            if      (solver.assignment[i] == 1) printf("%d ",  i);
-            else if (solver.assignment[i] == 0) printf("-%d ", i);
-            else                                printf("%d ",  i);
-        }
-        printf("0\n");
-    } else {
-        printf("UNSAT\n");
+static int decide(Solver *s) {
+    while (s->heap_size > 0) {
+        int var = heap_pop(s);
+        if (var_value(s, var) == UNASSIGNED && !s->eliminated[var])
+            return s->phase[var] ? var : -var;
     }
+    return 0;
 }
 
 /* ══════════════════════════════════════════════════════════════════════════ */
-/* Decode and pretty-print the Sudoku grid                                    */
+/* Backtrack to given level                                                   */
 /*                                                                            */
-/*  Steps:                                                                    */
-/*    1. Allocate N×N grid, zero-filled.                                      */
-/*    2. Stamp in FIXED cells (pre-assigned, not in SAT variables).           */
-/*    3. For each SAT variable assigned TRUE, use var_info[] to find          */
-/*       which cell and value it represents, stamp into grid.                 */
+/*  After a chronological backtrack the trail is no longer sorted by level: */
+/*  a literal implied at level 3 can sit above the decision of level 7.     */
+/*  So everything from the start of level + 1 up is walked, literals of     */
+/*  higher levels are undone, and the others slide down in order and are    */
+/*  propagated again, since a conflict may have stopped propagation before  */
+/*  it reached them.                                                        */
 /* ══════════════════════════════════════════════════════════════════════════ */
 
-static void decode_and_print_sudoku(void) {
-    if (N <= 0) {
-        printf("(Sudoku decode skipped: no 'c SIZE N' comment found in CNF)\n");
-        return;
+static void backtrack(Solver *s, int level) {
+    if (level < s->level) {
+        int start = s->trail_lim[level], kept = start;
+        for (int i = start; i < s->trail_top; i++) {
+            int lit = s->trail[i];
+            int var = absval(lit);
+            if (s->vardata[var].level <= level) {
+                s->trail[kept++] = lit;
+                continue;
+            }
+            s->value[2 * var] = s->value[2 * var + 1] = UNASSIGNED;
+            s->vardata[var]   = (VarData){ 0, CREF_NONE };
+            s->phase[var]     = (char)(lit > 0);
+            heap_insert(s, var);
+        }
+        s->trail_top = kept;
+        if (s->qhead > start) s->qhead = start;
     }
+    /* level-0 units added since the last propagate() stay queued */
+    if (s->qhead > s->trail_top) s->qhead = s->trail_top;
+    s->level = level;
+}
 
-    /* ── allocate grid ──────────────────────────────────────────────────── */
-    int **grid = malloc((size_t)N * sizeof(int *));
-    for (int i = 0; i < N; i++)
-        grid[i] = calloc((size_t)N, sizeof(int));
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Literal block distance: number of distinct decision levels in a clause    */
+/* ══════════════════════════════════════════════════════════════════════════ */
 
-    /* ── stamp fixed (pre-assigned) cells ───────────────────────────────── */
-    for (int i = 0; i < fixed_count; i++) {
-        int r = fixed_flat[i*3],  c = fixed_flat[i*3+1],  v = fixed_flat[i*3+2];
-        if (r >= 1 && r <= N && c >= 1 && c <= N)
-            grid[r-1][c-1] = v;
+static int compute_lbd(Solver *s, const int *lits, int size) {
+    int lbd = 0;
+    s->cur_stamp++;
+    for (int i = 0; i < size; i++) {
+        int lv = s->vardata[absval(lits[i])].level;
+        if (s->lvl_stamp[lv] != s->cur_stamp) {
+            s->lvl_stamp[lv] = s->cur_stamp;
+            lbd++;
+        }
     }
+    return lbd;
+}
 
-    /* ── stamp free variables that were assigned TRUE ────────────────────── */
-    int conflicts = 0;
-    for (int var = 1; var <= solver.num_vars; var++) {
-        if (solver.assignment[var] != 1) continue;
-        if (var >= var_info_cap)          continue;
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* First-UIP conflict analysis                                                */
+/* Adds learned clause, returns backtrack level.                             */
+/* The learned clause has the UIP in lits[0] and its highest-level other     */
+/* literal in lits[1], so both watches are correct after backtracking.       */
+/*                                                                            */
+/*  Literals below the conflict level are collected while resolving, so the  */
+/*  cost is proportional to the implication graph actually visited.  Level-0 */
+/*  literals are false for good and are left out.  The clause is then        */
+/*  minimised: a literal whose reason consists only of literals already in   */
+/*  the clause (or of literals that are themselves redundant) is dropped.    */
+/* ══════════════════════════════════════════════════════════════════════════ */
 
-        VarEntry *e = &var_info[var];
-        if (e->r < 1 || e->r > N || e->c < 1 || e->c > N || e->v < 1) continue;
+/*
+ * Use a generation counter instead of memset to clear seen[]:
+ *   gen_of[v] == cur_gen  means  seen[v] is active.
+ */
+static inline bool is_seen(Solver *s, int v) {
+    return s->gen_of[v] == s->cur_gen && s->seen[v];
+}
+static inline void set_seen(Solver *s, int v, int val) {
+    s->gen_of[v] = s->cur_gen;
+    s->seen[v]   = val;
+}
 
-        int existing = grid[e->r - 1][e->c - 1];
-        if (existing != 0 && existing != e->v) {
-            fprintf(stderr,
-                "DECODE CONFLICT cell(%d,%d): existing=%d new=%d var=%d\n",
-                e->r, e->c, existing, e->v, var);
-            conflicts++;
+/* one bit per decision level (mod 32), for a cheap "could be implied" test */
+static inline unsigned abstract_level(Solver *s, int v) {
+    return 1u << (s->vardata[v].level & 31);
+}
+
+/*
+ * Is lit implied by the other literals of the learned clause?  Walks the
+ * reasons depth-first with an explicit stack; on failure every mark made
+ * during this call is undone so the next query starts clean.
+ */
+static bool lit_redundant(Solver *s, int lit, unsigned levels, int *stack,
+                          int *toclear, int *toclear_size) {
+    int top   = 0;
+    int first = *toclear_size;
+    stack[top++] = lit;
+
+    while (top > 0) {
+        int     u = absval(stack[--top]);
+        Clause *c = reason_clause(s, s->vardata[u].reason, u);
+        for (int i = 1; i < c->size; i++) {      /* lits[0] is the implied lit */
+            int q = c->lits[i];
+            int v = absval(q);
+            if (is_seen(s, v) || s->vardata[v].level == 0) continue;
+            if (s->vardata[v].reason != CREF_NONE &&
+                (abstract_level(s, v) & levels)) {
+                set_seen(s, v, 1);
+                stack[top++] = q;
+                toclear[(*toclear_size)++] = v;
+            } else {
+                for (int k = first; k < *toclear_size; k++)
+                    s->seen[toclear[k]] = 0;
+                *toclear_size = first;
+                return false;
+            }
         }
-        grid[e->r - 1][e->c - 1] = e->v;
     }
-    if (conflicts)
-        fprintf(stderr, "WARNING: %d decode conflicts detected.\n", conflicts);
+    return true;
+}
 
-    /* ── pretty-print ───────────────────────────────────────────────────── */
-    printf("\nSudoku solution (%dx%d):\n\n", N, N);
+/*
+ * The highest level in a conflict clause.  Propagating older literals
+ * again after a chronological backtrack can find a conflict below the
+ * current level; the search goes back to its level before analyze().
+ */
+static int conflict_level(Solver *s, CRef conflict_clause) {
+    Clause *c  = reason_clause(s, conflict_clause, 0);
+    int     lv = 0;
+    for (int i = 0; i < c->size; i++) {
+        int l = s->vardata[absval(c->lits[i])].level;
+        if (l > lv) lv = l;
+    }
+    return lv;
+}
 
-    /* box width = smallest integer whose square >= N */
-    int base = 1;
-    while (base * base < N) base++;
+static int analyze(Solver *s, CRef conflict_clause, CRef *learned_clause) {
+    s->cur_gen++;
 
-    for (int r = 0; r < N; r++) {
-        /* horizontal separator between box rows */
-        if (r > 0 && r % base == 0) {
-            int dashes = N * 2 + (N / base - 1) * 2;
-            for (int i = 0; i < dashes; i++) putchar('-');
-            putchar('\n');
+    /* a learned clause has at most one literal per variable */
+    int *learned = s->learned;
+    int *stack   = s->an_stack;
+    int *toclear = s->an_toclear;
+    int  size    = 1;                     /* learned[0] is kept for the UIP */
+    int  counter = 0;                     /* unresolved current-level lits  */
+    int  idx     = s->trail_top - 1;
+    int  p       = 0;
+    CRef cr      = conflict_clause;
+
+    /* resolve until one literal at current level remains (the UIP) */
+    do {
+        Clause *c = reason_clause(s, cr, absval(p));
+        if (c->learnt) {
+            /* glucose: a clause that keeps being used may earn a better LBD */
+            cla_bump(s, c);
+            if (p != 0 && c->lbd > GLUE_LBD) {
+                int lbd = compute_lbd(s, c->lits, c->size);
+                if ((unsigned)lbd < c->lbd) c->lbd = (unsigned)lbd;
+            }
         }
-        for (int c = 0; c < N; c++) {
-            /* vertical separator between box columns */
-            if (c > 0 && c % base == 0) printf("| ");
 
-            int val = grid[r][c];
-            if      (val == 0)  printf(". ");
-            else if (val <= 9)  printf("%d ", val);
-            else                printf("%c ", 'A' + val - 10);
+        /* for a reason clause lits[0] is p itself */
+        for (int i = (p == 0) ? 0 : 1; i < c->size; i++) {
+            int q = c->lits[i];
+            int v = absval(q);
+            if (is_seen(s, v) || s->vardata[v].level == 0) continue;
+            set_seen(s, v, 1);
+            var_bump(s, v);
+            if (s->vardata[v].level == s->level) counter++;
+            else                                    learned[size++] = q;
         }
-        putchar('\n');
+
+        /* older literals of lower levels can sit among the current ones */
+        while (!is_seen(s, absval(s->trail[idx])) ||
+               s->vardata[absval(s->trail[idx])].level != s->level) idx--;
+        p  = s->trail[idx--];
+        cr = s->vardata[absval(p)].reason;
+        s->seen[absval(p)] = 0;
+        counter--;
+    } while (counter > 0);
+    learned[0] = -p;
+
+    /* recursive minimisation */
+    unsigned levels = 0;
+    for (int i = 1; i < size; i++) levels |= abstract_level(s, absval(learned[i]));
+
+    int toclear_size = 0, kept = 1;
+    for (int i = 1; i < size; i++) {
+        int v = absval(learned[i]);
+        if (s->vardata[v].reason == CREF_NONE ||
+            !lit_redundant(s, learned[i], levels, stack, toclear, &toclear_size))
+            learned[kept++] = learned[i];
     }
+    size = kept;
 
-    /* ── cleanup ────────────────────────────────────────────────────────── */
-    for (int i = 0; i < N; i++) free(grid[i]);
-    free(grid);
+    /* watch order: UIP first, then a literal from the backtrack level */
+    int backtrack_level = 0;
+    for (int i = 1; i < size; i++) {
+        if (s->vardata[absval(learned[i])].level <= backtrack_level) continue;
+        backtrack_level = s->vardata[absval(learned[i])].level;
+        int t = learned[1]; learned[1] = learned[i]; learned[i] = t;
+    }
+
+    s->last_lbd    = compute_lbd(s, learned, size);
+    s->learned_len = size;
+    s->learned_total++;
+    s->learned_lits += size;
+    *learned_clause = add_clause(s, learned, size, true);
+    if (*learned_clause >= 0)
+        clause_at(s, *learned_clause)->lbd = (unsigned)s->last_lbd;
+    var_decay(s);
+    cla_decay(s);
+    return backtrack_level;
 }
 
 /* ══════════════════════════════════════════════════════════════════════════ */
-/* main                                                                       */
+/* Learned clause database reduction                                          */
+/*                                                                            */
+/*  Every REDUCE_FIRST + k*REDUCE_INC conflicts the learned clauses are      */
+/*  ranked by LBD, then activity, and the worse half is deleted.  Glue       */
+/*  clauses (LBD <= GLUE_LBD) and clauses that are currently the reason for  */
+/*  an assignment always survive.  Watchers of deleted clauses are dropped   */
+/*  straight away; the arena is compacted once enough of it is garbage.      */
 /* ══════════════════════════════════════════════════════════════════════════ */
 
-int main(int argc, char **argv) {
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s file.cnf\n", argv[0]);
-        return 1;
+static inline bool clause_locked(Solver *s, CRef cr) {
+    Clause *c = clause_at(s, cr);
+    int     v = absval(c->lits[0]);
+    return s->vardata[v].reason == cr && lit_value(s, c->lits[0]) == 1;
+}
+
+/* sort keys are copied out of the arena, as qsort passes no solver along */
+typedef struct {
+    unsigned lbd;
+    float    activity;
+    CRef     cr;
+} LearntKey;
+
+/* qsort order: worst clause first */
+static int learnt_cmp(const void *a, const void *b) {
+    const LearntKey *x = a, *y = b;
+    if (x->lbd != y->lbd) return x->lbd > y->lbd ? -1 : 1;
+    if (x->activity != y->activity) return x->activity < y->activity ? -1 : 1;
+    return 0;
+}
+
+static inline CRef forward(Solver *s, CRef cr) {
+    Clause *c = clause_at(s, cr);
+    return c->reloced ? c->lits[0] : cr;
+}
+
+/* Copy every live clause into a fresh arena and repoint all CRefs at it. */
+static void compact_arena(Solver *s) {
+    size_t new_cap = s->arena_cap;
+    int   *fresh   = malloc(new_cap * sizeof(int));
+    if (!fresh) { fprintf(stderr, "OOM: clause arena\n"); exit(1); }
+
+    size_t top = 0;
+    for (size_t cr = 0; cr < s->arena_size; ) {
+        Clause *c     = clause_at(s, (CRef)cr);
+        size_t  words = (size_t)CLAUSE_WORDS(c->size);
+        if (!c->deleted) {
+            memcpy(fresh + top, c, words * sizeof(int));
+            c->reloced = 1;
+            c->lits[0] = (int)top;
+            top += words;
+        }
+        cr += words;
     }
 
-    FILE *f = fopen(argv[1], "r");
-    if (!f) { fprintf(stderr, "Cannot open file: %s\n", argv[1]); return 1; }
+    for (int i = 0; i < 2 * s->num_vars + 2; i++) {
+        WatchList *wl = &s->watches[i];
+        for (int k = 0; k < wl->size; k++)
+            wl->ws[k].clause = forward(s, wl->ws[k].clause);
+    }
+    for (int i = 0; i < s->trail_top; i++) {
+        int v = absval(s->trail[i]);
+        if (s->vardata[v].reason >= 0)
+            s->vardata[v].reason = forward(s, s->vardata[v].reason);
+    }
+    for (int i = 0; i < s->num_learnts; i++)
+        s->learnts[i] = forward(s, s->learnts[i]);
 
-    parse_dimacs(f);
-    fclose(f);
+    free(s->arena);
+    s->arena        = fresh;
+    s->arena_size   = top;
+    s->arena_wasted = 0;
+}
 
-    int res = solve();
-    print_result(res);
+static void drop_deleted_watchers(Solver *s) {
+    for (int i = 0; i < 2 * s->num_vars + 2; i++) {
+        WatchList *wl = &s->watches[i];
+        int j = 0;
+        for (int k = 0; k < wl->size; k++)
+            if (!clause_at(s, wl->ws[k].clause)->deleted) wl->ws[j++] = wl->ws[k];
+        s->list_bytes -= (size_t)(wl->size - j) * sizeof(Watcher);
+        wl->size = j;
+    }
+}
+
+static void reduce_db(Solver *s) {
+    LearntKey *keys = malloc((size_t)s->num_learnts * sizeof(LearntKey) + 1);
+    if (!keys) { fprintf(stderr, "OOM: reduce_db\n"); exit(1); }
+    for (int i = 0; i < s->num_learnts; i++) {
+        Clause *c = clause_at(s, s->learnts[i]);
+        keys[i] = (LearntKey){c->lbd, c->activity, s->learnts[i]};
+    }
+    qsort(keys, (size_t)s->num_learnts, sizeof(LearntKey), learnt_cmp);
+    for (int i = 0; i < s->num_learnts; i++) s->learnts[i] = keys[i].cr;
+    free(keys);
 
-    if (res == SAT)
-        decode_and_print_sudoku();
+    int target = s->num_learnts / 2, removed = 0, kept = 0;
+    for (int i = 0; i < s->num_learnts; i++) {
+        CRef    cr = s->learnts[i];
+        Clause *c  = clause_at(s, cr);
+        if (removed < target && c->lbd > GLUE_LBD && c->size > 2 &&
+            !clause_locked(s, cr)) {
+            c->deleted = 1;
+            s->arena_wasted += (size_t)CLAUSE_WORDS(c->size);
+            removed++;
+        } else {
+            s->learnts[kept++] = cr;
+        }
+    }
+    s->num_learnts = kept;
 
-    /* ── cleanup ──────────────────────────────────────────────────────── */
-    for (int i = 0; i < solver.num_clauses; i++) free(solver.clauses[i].lits);
-    free(solver.clauses);
-    free(solver.assignment);
-    free(solver.level_of);
-    free(solver.reason);
-    free(solver.trail);
-    free(var_info);
-    free(fixed_flat);
+    drop_deleted_watchers(s);
+    if (s->arena_wasted > s->arena_size / 4) compact_arena(s);
+    s->reductions++;
+}
 
-    return 0;
-}
\ No newline at end of file
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Learned clause sharing (portfolio)                                         */
+/*                                                                            */
+/*  Each worker appends its short glue clauses to its own ring as records    */
+/*  [size, lbd, lits...]; it is the only writer, so publishing a record is   */
+/*  one release store of the head.  Readers keep a private cursor per ring   */
+/*  and import at restarts, when they are at level 0.  The writer may be     */
+/*  storing its next record, up to SHARE_RECORD ints past the head, before   */
+/*  that head is published, so a record is only trusted while it lies more   */
+/*  than SHARE_RECORD behind the lap line: the head read after it, plus      */
+/*  SHARE_RECORD, is at most a ring length past its start.  A reader lapped  */
+/*  that far skips ahead; a record overwritten while read is dropped.        */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    atomic_int  *ring;
+    atomic_long  head;     /* ints ever written */
+} ShareRing;
+
+typedef struct Share {
+    ShareRing *rings;      /* one per worker */
+    int        num;
+    long      *cursors;    /* [reader * num + writer], owned by the reader */
+} Share;
+
+/* offers the clause analyze(s) just learned */
+static void share_export(Solver *s) {
+    int size = s->learned_len;
+    if (size > SHARE_SIZE || s->last_lbd > SHARE_LBD) return;
+
+    ShareRing *r = &s->share->rings[s->share_id];
+    long       h = atomic_load_explicit(&r->head, memory_order_relaxed);
+    /* a reader that sees any of the stores below also sees head >= h */
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&r->ring[h % SHARE_RING], size,
+                          memory_order_relaxed);
+    atomic_store_explicit(&r->ring[(h + 1) % SHARE_RING], s->last_lbd,
+                          memory_order_relaxed);
+    for (int i = 0; i < size; i++)
+        atomic_store_explicit(&r->ring[(h + 2 + i) % SHARE_RING], s->learned[i],
+                              memory_order_relaxed);
+    atomic_store_explicit(&r->head, h + 2 + size, memory_order_release);
+    s->shared_out++;
+}
+
+/* adds a clause learned elsewhere, simplified against level 0 */
+static void import_clause(Solver *s, int *lits, int size, int lbd) {
+    int n = 0;
+    for (int i = 0; i < size; i++) {
+        int v = lit_value(s, lits[i]);
+        if (v == 1) return;
+        if (v == UNASSIGNED) lits[n++] = lits[i];
+    }
+    s->shared_in++;
+    if (n == 0) { s->ok = false; return; }
+    if (n == 1) { assign(s, lits[0], 0, CREF_NONE); return; }
+    CRef cr = add_clause(s, lits, n, true);
+    if (cr >= 0) clause_at(s, cr)->lbd = (unsigned)(lbd < n ? lbd : n);
+}
+
+static void share_import(Solver *s) {
+    Share *sh  = s->share;
+    int   *buf = s->learned;          /* analysis is idle at level 0 */
+    for (int w = 0; w < sh->num && s->ok; w++) {
+        if (w == s->share_id) continue;
+        ShareRing *r    = &sh->rings[w];
+        long      *cur  = &sh->cursors[s->share_id * sh->num + w];
+        long       head = atomic_load_explicit(&r->head, memory_order_acquire);
+        if (head - *cur + SHARE_RECORD > SHARE_RING) *cur = head;  /* lapped */
+
+        while (*cur < head && s->ok) {
+            long at   = *cur;
+            int  size = atomic_load_explicit(&r->ring[at % SHARE_RING],
+                                             memory_order_relaxed);
+            int  lbd  = atomic_load_explicit(&r->ring[(at + 1) % SHARE_RING],
+                                             memory_order_relaxed);
+            /* buf holds var_cap ints; a torn size must not overrun it */
+            bool sane = size >= 1 && size <= SHARE_SIZE && size <= s->num_vars;
+            for (int i = 0; sane && i < size; i++) {
+                buf[i] = atomic_load_explicit(&r->ring[(at + 2 + i) % SHARE_RING],
+                                              memory_order_relaxed);
+                sane = buf[i] != 0 && absval(buf[i]) <= s->num_vars;
+            }
+            atomic_thread_fence(memory_order_acquire);
+            long now = atomic_load_explicit(&r->head, memory_order_relaxed);
+            if (!sane || now - at + SHARE_RECORD > SHARE_RING) {
+                *cur = now;
+                break;
+            }
+            *cur = at + 2 + size;
+            import_clause(s, buf, size, lbd);
+        }
+    }
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Restart policies                                                           */
+/*                                                                            */
+/*  luby     restart after LUBY_UNIT * luby(i) conflicts: 1 1 2 1 1 2 4 ...  */
+/*  glucose  restart when the mean LBD of the last LBD_WINDOW learned        */
+/*           clauses, scaled by LBD_MARGIN, exceeds the mean over the whole  */
+/*           run — i.e. the recent clauses are worse than usual              */
+/*  none     never restart                                                    */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+static long luby(long i) {
+    /* find the finite subsequence containing index i, and its size */
+    long size = 1, seq = 0;
+    while (size < i + 1) { seq++; size = 2 * size + 1; }
+    while (size - 1 != i) { size = (size - 1) >> 1; seq--; i = i % size; }
+    return 1L << seq;
+}
+
+static void restart_on_conflict(Solver *s, int lbd) {
+    s->conflicts++;
+    s->conflicts_since_restart++;
+    s->lbd_total += lbd;
+
+    if (s->lbd_queue_len == LBD_WINDOW)
+        s->lbd_queue_sum -= s->lbd_queue[s->lbd_queue_head];
+    else
+        s->lbd_queue_len++;
+    s->lbd_queue[s->lbd_queue_head] = lbd;
+    s->lbd_queue_sum += lbd;
+    s->lbd_queue_head = (s->lbd_queue_head + 1) % LBD_WINDOW;
+}
+
+static bool restart_due(Solver *s) {
+    switch (s->restart_policy) {
+    case RESTART_LUBY:
+        return s->conflicts_since_restart >= LUBY_UNIT * luby(s->restarts);
+    case RESTART_GLUCOSE:
+        if (s->lbd_queue_len < LBD_WINDOW) return false;
+        return (double)s->lbd_queue_sum / LBD_WINDOW * LBD_MARGIN >
+               s->lbd_total / (double)s->conflicts;
+    default:
+        return false;
+    }
+}
+
+/*
+ * Trail reuse: the decisions that would be taken again right after the
+ * restart, the ones more active than the best unassigned variable, keep
+ * their levels.  Sharing imports at level 0, so a portfolio worker still
+ * goes all the way back.
+ */
+static int reuse_level(Solver *s) {
+    int next = 0;
+    while (s->heap_size > 0) {
+        int v = s->heap[0];
+        if (var_value(s, v) == UNASSIGNED && !s->eliminated[v]) {
+            next = v;
+            break;
+        }
+        heap_pop(s);
+    }
+    if (next == 0 || s->share) return 0;
+    int level = s->num_assumps < s->level ? s->num_assumps : s->level;
+    while (level < s->level &&
+           heap_before(s, absval(s->trail[s->trail_lim[level]]), next))
+        level++;
+    return level;
+}
+
+static void restart(Solver *s) {
+    int keep = reuse_level(s);
+    s->reused_levels += keep;
+    backtrack(s, keep);
+    if (s->share) share_import(s);
+    s->restarts++;
+    s->conflicts_since_restart = 0;
+    s->lbd_queue_len  = 0;   /* glucose: refill the window first */
+    s->lbd_queue_head = 0;
+    s->lbd_queue_sum  = 0;
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Assumptions                                                                */
+/*                                                                            */
+/*  Assumption i is decided at level i + 1, before any free decision; if it  */
+/*  already holds the level is left empty so the numbering stays fixed.      */
+/*  When an assumption p is found false, the trail is walked back from ~p    */
+/*  to collect the assumptions it was derived from: those, with p, are the   */
+/*  failed set ipasir_failed() reports.                                      */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+static void analyze_final(Solver *s, int p) {
+    s->num_failed = 0;
+    push_int(&s->failed, &s->num_failed, &s->failed_cap, p, "failed");
+    if (s->vardata[absval(p)].level == 0) return;
+
+    s->cur_gen++;
+    set_seen(s, absval(p), 1);
+    for (int i = s->trail_top - 1; i >= 0; i--) {
+        int v = absval(s->trail[i]);
+        if (!is_seen(s, v)) continue;
+        if (s->vardata[v].reason == CREF_NONE) {
+            /* only assumptions are decided below the first free decision */
+            push_int(&s->failed, &s->num_failed, &s->failed_cap, s->trail[i],
+                     "failed");
+        } else {
+            Clause *c = reason_clause(s, s->vardata[v].reason, v);
+            for (int k = 1; k < c->size; k++)
+                if (s->vardata[absval(c->lits[k])].level > 0)
+                    set_seen(s, absval(c->lits[k]), 1);
+        }
+        s->seen[v] = 0;
+    }
+}
+
+/* hands the clause just learned to the ipasir_set_learn() callback */
+static void export_learnt(Solver *s) {
+    if (s->learned_len > s->learn_max) return;
+    int32_t *out = (int32_t *)s->learned;    /* free again until the next analyze */
+    out[s->learned_len] = 0;
+    s->learn(s->learn_data, out);
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* CDCL main loop                                                             */
+/*                                                                            */
+/*  Starts from level 0 with whatever the previous call learned, and leaves  */
+/*  a satisfying assignment on the trail.  The assumptions are consumed.     */
+/*  Returns SAT, UNSAT, or UNKNOWN if the terminate callback fired or a      */
+/*  budget ran out (s->limit_hit says which); the counters show how far it   */
+/*  got, and a later call carries on from what it learned.                   */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+/* polled once per conflict; the clock is read every 64 conflicts only */
+static bool budget_spent(Solver *s, long conflict_end, double deadline) {
+    const Budget *b = &s->budget;
+    if (b->conflicts > 0 && s->conflicts >= conflict_end)
+        s->limit_hit = "conflicts";
+    else if (b->mem_bytes > 0 &&
+             (s->arena_size - s->arena_wasted) * sizeof(int) + s->list_bytes >
+                 b->mem_bytes)
+        s->limit_hit = "memory";
+    else if (b->time_ms > 0 && (s->conflicts & 63) == 0 && now_ms() >= deadline)
+        s->limit_hit = "time";
+    return s->limit_hit != NULL;
+}
+
+static int solve(Solver *s) {
+    backtrack(s, 0);
+    s->num_failed = 0;
+    s->limit_hit  = NULL;
+    long   conflict_end = s->conflicts + s->budget.conflicts;
+    double deadline     = s->budget.time_ms > 0 ? now_ms() + s->budget.time_ms : 0;
+
+    /* every level holds a decision or a (possibly empty) assumption level */
+    reserve_levels(s, s->num_vars + s->num_assumps + 1);
+
+    int res = UNKNOWN;
+    while (s->ok) {
+        CRef conflict = propagate(s);
+        if (conflict != CREF_NONE) {
+            int cl = conflict_level(s, conflict);
+            if (cl == 0) { s->ok = false; break; }
+            backtrack(s, cl);
+            CRef learned;
+            int  bt = analyze(s, conflict, &learned);
+            /* a long jump would undo levels the clause has nothing to do */
+            /* with, and their propagation would only be repeated          */
+            int  to = cl - bt > CHRONO_DIST ? cl - 1 : bt;
+            if (to != bt) s->chrono_backtracks++;
+            backtrack(s, to);
+            assign(s, s->learned[0], bt, learned);
+            restart_on_conflict(s, s->last_lbd);
+            if (s->learn) export_learnt(s);
+            if (s->share) share_export(s);
+            if (s->conflicts >= s->next_reduce) {
+                reduce_db(s);
+                s->next_reduce = s->conflicts +
+                                 REDUCE_FIRST + REDUCE_INC * s->reductions;
+            }
+            if (s->terminate && s->terminate(s->term_data)) break;
+            if (budget_spent(s, conflict_end, deadline)) break;
+            continue;
+        }
+        if (s->level > 0 && restart_due(s)) {
+            restart(s);
+            continue;
+        }
+
+        int lit = 0;
+        while (s->level < s->num_assumps) {
+            int a = s->assumps[s->level];
+            int v = lit_value(s, a);
+            if (v == 1) { new_level(s); continue; }
+            if (v == 0) { analyze_final(s, a); res = UNSAT; break; }
+            lit = a;
+            break;
+        }
+        if (res == UNSAT) break;
+        if (lit == 0) lit = decide(s);
+        if (lit == 0) { res = SAT; break; }
+        new_level(s);
+        s->decisions++;
+        assign(s, lit, s->level, CREF_NONE);
+    }
+    if (!s->ok) res = UNSAT;
+    s->num_assumps = 0;
+    return res;
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* DIMACS parser — reads clause lines AND c SIZE / c MAP / c FIXED comments  */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+static void ensure_var_info(Solver *s, int var) {
+    if (var < s->var_info_cap) return;
+    int new_cap = s->var_info_cap ? s->var_info_cap * 2 : 1024;
+    while (new_cap <= var) new_cap *= 2;
+    s->var_info = realloc(s->var_info, (size_t)new_cap * sizeof(VarEntry));
+    if (!s->var_info) { fprintf(stderr, "OOM: var_info\n"); exit(1); }
+    memset(s->var_info + s->var_info_cap, 0,
+           (size_t)(new_cap - s->var_info_cap) * sizeof(VarEntry));
+    s->var_info_cap = new_cap;
+}
+
+static void push_fixed(Solver *s, int r, int c, int v) {
+    if (s->fixed_count * 3 + 3 > s->fixed_cap) {
+        s->fixed_cap = s->fixed_cap ? s->fixed_cap * 2 : 192;
+        s->fixed_flat = realloc(s->fixed_flat, (size_t)s->fixed_cap * sizeof(int));
+        if (!s->fixed_flat) { fprintf(stderr, "OOM: fixed_flat\n"); exit(1); }
+    }
+    s->fixed_flat[s->fixed_count * 3 + 0] = r;
+    s->fixed_flat[s->fixed_count * 3 + 1] = c;
+    s->fixed_flat[s->fixed_count * 3 + 2] = v;
+    s->fixed_count++;
+}
+
+/* grow p to hold cap + 1 elements of the given size */
+static void *grow_array(void *p, int cap, size_t elem, const char *what) {
+    p = realloc(p, (size_t)(cap + 1) * elem);
+    if (!p) { fprintf(stderr, "OOM: %s\n", what); exit(1); }
+    return p;
+}
+
+/*
+ * Makes variables 1..n usable.  Called with the 'p cnf' count, and again
+ * whenever a clause or assumption mentions a larger variable; capacity
+ * doubles so an under-declared header does not cost a realloc per variable.
+ */
+static void resize_vars(Solver *s, int n) {
+    int old = s->num_vars;
+    if (n <= old && s->value) return;
+
+    if (n > s->var_cap || !s->value) {
+        int cap = s->var_cap * 2 > n ? s->var_cap * 2 : n;
+        s->value      = grow_array(s->value,      2 * cap + 1, 1,    "value");
+        s->vardata    = grow_array(s->vardata,    cap, sizeof(VarData), "vardata");
+        s->trail      = grow_array(s->trail,      cap, sizeof(int),    "trail");
+        s->activity   = grow_array(s->activity,   cap, sizeof(double), "activity");
+        s->heap       = grow_array(s->heap,       cap, sizeof(int),    "heap");
+        s->heap_pos   = grow_array(s->heap_pos,   cap, sizeof(int),    "heap_pos");
+        s->phase      = grow_array(s->phase,      cap, sizeof(char),   "phase");
+        s->eliminated = grow_array(s->eliminated, cap, sizeof(char),   "eliminated");
+        s->seen       = grow_array(s->seen,       cap, sizeof(int),    "seen");
+        s->gen_of     = grow_array(s->gen_of,     cap, sizeof(int),    "gen_of");
+        s->learned    = grow_array(s->learned,    cap, sizeof(int),    "learned");
+        s->an_stack   = grow_array(s->an_stack,   cap, sizeof(int),    "an_stack");
+        s->an_toclear = grow_array(s->an_toclear, cap, sizeof(int),    "an_toclear");
+
+        /* two watch lists per variable, 2*var and 2*var+1 */
+        int old_ws = s->watches ? 2 * s->var_cap + 2 : 0;
+        s->watches = realloc(s->watches,
+                             (size_t)(2 * cap + 2) * sizeof(WatchList));
+        if (!s->watches) { fprintf(stderr, "OOM: watches\n"); exit(1); }
+        memset(s->watches + old_ws, 0,
+               (size_t)(2 * cap + 2 - old_ws) * sizeof(WatchList));
+        s->bins = realloc(s->bins, (size_t)(2 * cap + 2) * sizeof(BinList));
+        if (!s->bins) { fprintf(stderr, "OOM: binary clauses\n"); exit(1); }
+        memset(s->bins + old_ws, 0,
+               (size_t)(2 * cap + 2 - old_ws) * sizeof(BinList));
+        s->amo_occ = realloc(s->amo_occ, (size_t)(2 * cap + 2) * sizeof(OccList));
+        if (!s->amo_occ) { fprintf(stderr, "OOM: amo occurrences\n"); exit(1); }
+        memset(s->amo_occ + old_ws, 0,
+               (size_t)(2 * cap + 2 - old_ws) * sizeof(OccList));
+        s->var_cap = cap;
+    }
+
+    for (int i = old ? old + 1 : 0; i <= n; i++) {
+        set_var_value(s, i, UNASSIGNED);
+        s->vardata[i]    = (VarData){ 0, CREF_NONE };
+        s->activity[i]   = 0.0;
+        s->heap_pos[i]   = -1;
+        s->phase[i]      = 1;
+        s->eliminated[i] = 0;
+        s->gen_of[i]     = 0;
+        s->seen[i]       = 0;
+    }
+    s->num_vars = n;
+
+    /* new variables have activity 0: appending them keeps the heap valid */
+    for (int i = old + 1; i <= n; i++) {
+        s->heap[s->heap_size] = i;
+        s->heap_pos[i] = s->heap_size++;
+    }
+}
+
+/*
+ * Hand-rolled scanner over the raw file bytes.  p is the cursor, end one
+ * past the last byte; nothing is copied and the buffer need not be
+ * NUL-terminated.
+ */
+static inline void skip_blanks(const char **p, const char *end) {
+    while (*p < end && (**p == ' ' || **p == '\t' || **p == '\r')) (*p)++;
+}
+
+static inline void skip_line(const char **p, const char *end) {
+    const char *nl = memchr(*p, '\n', (size_t)(end - *p));
+    *p = nl ? nl + 1 : end;
+}
+
+/* reads one signed decimal; returns false if the cursor is not on one */
+static inline bool scan_int(const char **p, const char *end, int *out) {
+    skip_blanks(p, end);
+    const char *q = *p;
+    bool neg = false;
+    if (q < end && *q == '-') { neg = true; q++; }
+    if (q >= end || *q < '0' || *q > '9') return false;
+    int v = 0;
+    while (q < end && *q >= '0' && *q <= '9') v = v * 10 + (*q++ - '0');
+    *out = neg ? -v : v;
+    *p   = q;
+    return true;
+}
+
+/* does the line at p start with the given keyword followed by a blank? */
+static inline bool match_word(const char *p, const char *end, const char *w,
+                              size_t n) {
+    return (size_t)(end - p) > n && memcmp(p, w, n) == 0 &&
+           (p[n] == ' ' || p[n] == '\t');
+}
+
+/*
+ * Parses a whole DIMACS file held in memory.  Clauses may span lines and
+ * end at their terminating 0; a trailing clause without one is kept.
+ * Returns false if there is no 'p cnf' line before the first clause.
+ */
+static bool parse_dimacs(Solver *s, const char *buf, size_t len) {
+    const char *p = buf, *end = buf + len;
+    int  cap   = INIT_LIT_BUF;
+    int *lits  = malloc((size_t)cap * sizeof(int));
+    int  count = 0;
+    bool header = false;
+    if (!lits) { fprintf(stderr, "OOM: clause buffer\n"); exit(1); }
+
+    while (p < end) {
+        skip_blanks(&p, end);
+        if (p >= end) break;
+
+        /* ── comment line ──────────────────────────────────────────────── */
+        if (*p == 'c') {
+            const char *q = p + 1;
+            skip_blanks(&q, end);
+            int vi, r, c, v;
+            if (match_word(q, end, "SIZE", 4)) {
+                q += 4;
+                if (scan_int(&q, end, &v)) s->N = v;
+            } else if (match_word(q, end, "MAP", 3)) {
+                q += 3;
+                if (scan_int(&q, end, &vi) && scan_int(&q, end, &r) &&
+                    scan_int(&q, end, &c)  && scan_int(&q, end, &v) && vi > 0) {
+                    ensure_var_info(s, vi);
+                    s->var_info[vi] = (VarEntry){r, c, v};
+                }
+            } else if (match_word(q, end, "FIXED", 5)) {
+                q += 5;
+                if (scan_int(&q, end, &r) && scan_int(&q, end, &c) &&
+                    scan_int(&q, end, &v))
+                    push_fixed(s, r, c, v);
+            }
+            skip_line(&p, end);
+            continue;
+        }
+
+        /* ── problem line ──────────────────────────────────────────────── */
+        if (*p == 'p') {
+            const char *q = p + 1;
+            skip_blanks(&q, end);
+            int dv = 0, dc = 0;
+            if (match_word(q, end, "cnf", 3)) {
+                q += 3;
+                scan_int(&q, end, &dv);
+                scan_int(&q, end, &dc);
+            }
+            if (header) { free(lits); return false; }   /* second header */
+            header = true;
+            resize_vars(s, dv);   /* the arena grows as clauses arrive */
+            skip_line(&p, end);
+            continue;
+        }
+
+        if (*p == '%') break;                /* SATLIB end-of-data marker */
+        if (*p == '\n') { p++; continue; }
+
+        /* ── clause literals ───────────────────────────────────────────── */
+        if (!header) { free(lits); return false; }
+        int lit;
+        if (!scan_int(&p, end, &lit)) { skip_line(&p, end); continue; }
+        if (lit == 0) {
+            if (count > 0) add_clause(s, lits, count, false);
+            count = 0;
+            continue;
+        }
+        if (absval(lit) > s->num_vars) resize_vars(s, absval(lit));
+        if (count == cap) {
+            lits = realloc(lits, (size_t)(cap *= 2) * sizeof(int));
+            if (!lits) { fprintf(stderr, "OOM: clause buffer\n"); exit(1); }
+        }
+        lits[count++] = lit;
+    }
+    if (count > 0) add_clause(s, lits, count, false);
+    free(lits);
+    return header;
+}
+
+/*
+ * Finds at-most-one groups in a plain CNF: a clause of three or more
+ * literals whose literals are pairwise excluded by binary clauses
+ * (-a | -b) becomes a group, and the binaries it covers are deleted.  On
+ * the Python Sudoku encoding this recovers every uniqueness constraint.
+ */
+static void extract_amo_groups(Solver *s) {
+    int nl = 2 * s->num_vars + 2;
+    int *mark = calloc((size_t)nl, sizeof(int));
+    int *hit  = calloc((size_t)nl, sizeof(int));
+    if (!mark || !hit) { fprintf(stderr, "OOM: amo detection\n"); exit(1); }
+
+    /* the partners b of a, with a clause (-a | -b), are -bins[-a] */
+    int stamp = 0, probe_stamp = 0, first_group = s->num_amo;
+    for (size_t cr = 0; cr < s->arena_size;
+         cr += (size_t)CLAUSE_WORDS(clause_at(s, (CRef)cr)->size)) {
+        Clause *c = clause_at(s, (CRef)cr);
+        if (c->size < 3 || c->learnt || c->deleted) continue;
+        bool group = true;
+        stamp++;
+        for (int i = 0; i < c->size && group; i++) {
+            int w = watch_index(c->lits[i]);
+            if (mark[w] == stamp) group = false;     /* repeated literal */
+            mark[w] = stamp;
+        }
+        for (int i = 0; i < c->size && group; i++) {
+            int      a  = watch_index(c->lits[i]), found = 0;
+            BinList *bl = &s->bins[watch_index(-c->lits[i])];
+            if (bl->size < c->size - 1) { group = false; break; }
+            probe_stamp++;
+            for (int k = 0; k < bl->size; k++) {
+                int b = watch_index(-bl->lits[k]);
+                if (mark[b] == stamp && b != a && hit[b] != probe_stamp) {
+                    hit[b] = probe_stamp;
+                    found++;
+                }
+            }
+            group = found == c->size - 1;
+        }
+        /* add_amo() may grow nothing the arena holds, so c stays valid */
+        if (group) add_amo(s, c->lits, c->size);
+    }
+    free(hit);
+    free(mark);
+
+    /* delete the binaries a group now covers, from both of their lists */
+    int gstamp = 0;
+    int *gmark = calloc((size_t)s->num_amo + 1, sizeof(int));
+    if (!gmark) { fprintf(stderr, "OOM: amo detection\n"); exit(1); }
+    long removed = 0;
+    for (int w = 2; w < nl; w++) {
+        BinList *bl = &s->bins[w];
+        OccList *a  = &s->amo_occ[watch_index(-index_lit(w))];
+        if (a->size == 0) continue;
+        gstamp++;
+        for (int k = 0; k < a->size; k++)
+            if (a->ids[k] >= first_group) gmark[a->ids[k]] = gstamp;
+        int kept = 0;
+        for (int k = 0; k < bl->size; k++) {
+            OccList *b       = &s->amo_occ[watch_index(-bl->lits[k])];
+            bool     covered = false;
+            for (int g = 0; g < b->size && !covered; g++)
+                covered = gmark[b->ids[g]] == gstamp;
+            if (covered) removed++;
+            else         bl->lits[kept++] = bl->lits[k];
+        }
+        s->list_bytes -= (size_t)(bl->size - kept) * sizeof(int);
+        bl->size = kept;
+    }
+    free(gmark);
+    s->num_clauses -= (int)(removed / 2);
+}
+
+/*
+ * Maps the file read-only; falls back to reading it whole (pipes, or
+ * filesystems without mmap).  *mapped tells the caller how to release it.
+ */
+static char *load_file(const char *path, size_t *len, bool *mapped) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    char *buf = NULL;
+    *mapped = false;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m != MAP_FAILED) {
+            posix_madvise(m, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+            buf     = m;
+            *len    = (size_t)st.st_size;
+            *mapped = true;
+        }
+    }
+    if (!buf) {
+        size_t cap = 1 << 16, n = 0;
+        buf = malloc(cap);
+        for (;;) {
+            if (!buf) { fprintf(stderr, "OOM: file buffer\n"); exit(1); }
+            ssize_t r = read(fd, buf + n, cap - n);
+            if (r <= 0) break;
+            n += (size_t)r;
+            if (n == cap) buf = realloc(buf, cap *= 2);
+        }
+        *len = n;
+    }
+    close(fd);
+    return buf;
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Sudoku puzzle encoder — Puzzles/<name>.txt straight to clauses, no CNF file */
+/*                                                                            */
+/*  Same φ' encoding as sudoku_to_cnf.py: every (r,c,v) is V+ (given), V-    */
+/*  (excluded by a given in its cell, row, column or box) or V0 (free).      */
+/*  Only V0 gets a variable, numbered in (r,c,v) order; satisfied clauses    */
+/*  are dropped and false literals removed, so the variable numbering and    */
+/*  the definedness clauses match the Python output exactly.  Each          */
+/*  uniqueness constraint becomes one at-most-one group over its free        */
+/*  literals instead of its pairwise clauses (a pair stays a clause).        */
+/*                                                                            */
+/*  Unless --no-preprocess is given, apply_sudoku_rules() first moves every  */
+/*  (r,c,v) the Sudoku rules decide from V0 into V+ or V-, which shrinks   */
+/*  V0 and renumbers what remains.                                           */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+enum { CELL_FREE = 0, CELL_GIVEN, CELL_EXCLUDED };
+
+typedef struct {
+    Solver        *s;
+    int            N;
+    unsigned char *state;        /* [(r*N + c)*N + v], 0-indexed, CELL_*   */
+    int           *var;          /* same index -> DIMACS variable (V0)     */
+    int           *lits;         /* clause under construction, N literals  */
+    int            len;
+    bool           satisfied;
+} PuzzleEncoder;
+
+/* the line at p is exactly the keyword, blanks aside */
+static bool match_line(const char *p, const char *end, const char *w, size_t n) {
+    if ((size_t)(end - p) < n || memcmp(p, w, n) != 0) return false;
+    p += n;
+    skip_blanks(&p, end);
+    return p == end || *p == '\n';
+}
+
+static bool is_puzzle(const char *buf, size_t len) {
+    const char *p = buf;
+    skip_blanks(&p, buf + len);
+    return match_word(p, buf + len, "SIZE", 4);
+}
+
+/*
+ * The kernels from here to encode_puzzle() take N and the box width as
+ * arguments and are forced inline, so each encode_board_<N>() below is the
+ * whole front end compiled for one constant N: strides and box divisions
+ * fold into immediates, unit loops get fixed trip counts, and the rules'
+ * candidate and unit tables live on its stack.  Other sizes run the same
+ * body with runtime values.
+ */
+#if defined(__GNUC__)
+#define KERNEL static inline __attribute__((always_inline))
+#else
+#define KERNEL static inline
+#endif
+
+KERNEL void enc_lit(PuzzleEncoder *e, int N, int r, int c, int v, bool neg) {
+    int i = (r * N + c) * N + v;
+    if (e->state[i] == CELL_GIVEN)         e->satisfied |= !neg;
+    else if (e->state[i] == CELL_EXCLUDED) e->satisfied |= neg;
+    else e->lits[e->len++] = neg ? -e->var[i] : e->var[i];
+}
+
+static inline void enc_end(PuzzleEncoder *e) {
+    if (!e->satisfied && e->len > 0) add_clause(e->s, e->lits, e->len, false);
+    e->len       = 0;
+    e->satisfied = false;
+}
+
+/* at most one of the collected literals; they were added negated */
+static inline void enc_end_amo(PuzzleEncoder *e) {
+    if (e->len == 2) {
+        add_clause(e->s, e->lits, 2, false);
+    } else if (e->len > 2) {
+        for (int i = 0; i < e->len; i++) e->lits[i] = -e->lits[i];
+        add_amo(e->s, e->lits, e->len);
+    }
+    e->len       = 0;
+    e->satisfied = false;
+}
+
+/* cell k (0..N-1) of unit u (0..N-1) of the given kind */
+KERNEL void unit_cell(int kind, int box, int u, int k, int *r, int *c) {
+    switch (kind) {
+    case 0:  *r = u; *c = k; break;                                   /* row */
+    case 1:  *r = k; *c = u; break;                                   /* col */
+    default: *r = u / box * box + k / box; *c = u % box * box + k % box;
+    }
+}
+
+/*
+ * Sudoku rules on candidate bitsets, one 64-bit word per cell (N <= 64):
+ * naked singles, hidden singles, and pointing / box-line reductions, until
+ * none applies.  Cells it places become givens and candidates it removes
+ * become V-, so the encoding that follows only sees what is left.  Returns
+ * false if a cell or a unit runs out of candidates.
+ */
+typedef struct {
+    int       *grid;             /* placed value per cell, 0 if open      */
+    uint64_t  *cand;             /* candidate values per cell, bit v - 1  */
+    const int *unit;             /* [u * N + k]: cell k of unit u, 3N units */
+    bool       changed;
+} SudokuRules;
+
+KERNEL bool rules_place(SudokuRules *sr, int N, int box, int cell, int v) {
+    int r = cell / N, c = cell % N;
+    sr->grid[cell] = v + 1;
+    sr->cand[cell] = 1ull << v;
+    sr->changed    = true;
+    int units[3] = { r, N + c, 2 * N + r / box * box + c / box };
+    for (int i = 0; i < 3; i++)
+        for (int k = 0; k < N; k++) {
+            int peer = sr->unit[units[i] * N + k];
+            if (peer == cell || !(sr->cand[peer] & (1ull << v))) continue;
+            if (sr->grid[peer]) return false;         /* two givens clash */
+            if (!(sr->cand[peer] &= ~(1ull << v))) return false;
+        }
+    return true;
+}
+
+KERNEL bool in_unit(int N, int box, int cell, int u) {
+    int r = cell / N, c = cell % N;
+    if (u < N)     return r == u;
+    if (u < 2 * N) return c == u - N;
+    return r / box * box + c / box == u - 2 * N;
+}
+
+/* drop v from the cells of unit u outside unit keep */
+KERNEL bool rules_eliminate(SudokuRules *sr, int N, int box, int u, int keep,
+                            int v) {
+    for (int k = 0; k < N; k++) {
+        int cell = sr->unit[u * N + k];
+        if (sr->grid[cell] || !(sr->cand[cell] & (1ull << v))) continue;
+        if (in_unit(N, box, cell, keep)) continue;
+        if (!(sr->cand[cell] &= ~(1ull << v))) return false;
+        sr->changed = true;
+    }
+    return true;
+}
+
+/* cand holds N*N words and unit 3*N*N cells; both are filled here */
+KERNEL bool apply_sudoku_rules(int N, int box, int *grid, unsigned char *state,
+                               uint64_t *cand, int *unit) {
+    int cells = N * N;
+    for (int kind = 0; kind < 3; kind++)
+        for (int u = 0; u < N; u++)
+            for (int k = 0; k < N; k++) {
+                int r, c;
+                unit_cell(kind, box, u, k, &r, &c);
+                unit[(kind * N + u) * N + k] = r * N + c;
+            }
+    for (int i = 0; i < cells; i++) {
+        cand[i] = 0;
+        for (int v = 0; v < N; v++)
+            if (state[i * N + v] != CELL_EXCLUDED) cand[i] |= 1ull << v;
+    }
+
+    SudokuRules sr = { grid, cand, unit, true };
+    bool ok = true;
+    for (int i = 0; i < cells && ok; i++)
+        ok = cand[i] != 0;
+    while (ok && sr.changed) {
+        sr.changed = false;
+
+        /* naked singles */
+        for (int i = 0; i < cells && ok; i++)
+            if (!grid[i] && !(cand[i] & (cand[i] - 1))) {
+                int v = 0;
+                while (!(cand[i] >> v & 1)) v++;
+                ok = rules_place(&sr, N, box, i, v);
+            }
+
+        /* hidden singles: v fits in only one cell of a unit */
+        for (int u = 0; u < 3 * N && ok; u++)
+            for (int v = 0; v < N && ok; v++) {
+                int where = -1, count = 0, placed = 0;
+                for (int k = 0; k < N; k++) {
+                    int cell = unit[u * N + k];
+                    if (!(cand[cell] >> v & 1)) continue;
+                    where = cell;
+                    count++;
+                    placed += grid[cell] != 0;
+                }
+                if (count == 0 || placed > 1) ok = false;
+                else if (count == 1 && !grid[where])
+                    ok = rules_place(&sr, N, box, where, v);
+            }
+
+        /* pointing (box confines v to one line) and box-line reduction
+         * (line confines v to one box): clear v from the rest of the other */
+        for (int u = 0; u < 3 * N && ok; u++)
+            for (int v = 0; v < N && ok; v++) {
+                int row = -1, col = -1, blk = -1;
+                bool one_row = true, one_col = true, one_blk = true;
+                for (int k = 0; k < N; k++) {
+                    int cell = unit[u * N + k];
+                    if (grid[cell] || !(cand[cell] >> v & 1)) continue;
+                    int r = cell / N, c = cell % N, b = r / box * box + c / box;
+                    one_row &= row < 0 || row == r;  row = r;
+                    one_col &= col < 0 || col == c;  col = c;
+                    one_blk &= blk < 0 || blk == b;  blk = b;
+                }
+                if (row < 0) continue;                 /* v placed or gone */
+                if (u >= 2 * N) {
+                    if (one_row) ok = rules_eliminate(&sr, N, box, row, u, v);
+                    if (one_col && ok)
+                        ok = rules_eliminate(&sr, N, box, N + col, u, v);
+                } else if (one_blk) {
+                    ok = rules_eliminate(&sr, N, box, 2 * N + blk, u, v);
+                }
+            }
+    }
+
+    for (int i = 0; i < cells && ok; i++)
+        for (int v = 0; v < N; v++) {
+            unsigned char *st = &state[i * N + v];
+            if (grid[i]) *st = grid[i] == v + 1 ? CELL_GIVEN : CELL_EXCLUDED;
+            else if (!(cand[i] >> v & 1)) *st = CELL_EXCLUDED;
+        }
+    return ok;
+}
+
+/* everything after parsing: partition, rules, numbering, metadata, clauses */
+KERNEL void encode_board(Solver *s, int *grid, int N, int box,
+                         uint64_t *cand, int *unit) {
+    size_t cells = (size_t)N * (size_t)N;
+    PuzzleEncoder e = { s, N, calloc(cells * (size_t)N, 1),
+                        calloc(cells * (size_t)N, sizeof(int)),
+                        malloc((size_t)N * sizeof(int)), 0, false };
+    if (!e.state || !e.var || !e.lits) { fprintf(stderr, "OOM: encoder\n"); exit(1); }
+
+    /* ── partition: V+ first, then everything a given rules out ─────────── */
+    for (int r = 0; r < N; r++)
+        for (int c = 0; c < N; c++)
+            if (grid[r * N + c])
+                e.state[(r * N + c) * N + grid[r * N + c] - 1] = CELL_GIVEN;
+    for (int r = 0; r < N; r++)
+        for (int c = 0; c < N; c++) {
+            int v = grid[r * N + c] - 1;
+            if (v < 0) continue;
+            for (int k = 0; k < N; k++) {
+                int rr, cc;
+                for (int kind = 0; kind < 3; kind++) {
+                    unit_cell(kind, box, kind == 0 ? r : kind == 1 ? c
+                              : r / box * box + c / box, k, &rr, &cc);
+                    if (rr != r || cc != c) {
+                        unsigned char *st = &e.state[(rr * N + cc) * N + v];
+                        if (*st != CELL_GIVEN) *st = CELL_EXCLUDED;
+                    }
+                }
+                unsigned char *st = &e.state[(r * N + c) * N + k];
+                if (k != v && *st != CELL_GIVEN) *st = CELL_EXCLUDED;
+            }
+        }
+    if (s->preprocess && cand && !apply_sudoku_rules(N, box, grid, e.state,
+                                                     cand, unit))
+        s->ok = false;          /* clauses still added, so the metadata is whole */
+
+    int num_vars = 0;
+    for (size_t i = 0; i < cells * (size_t)N; i++)
+        if (e.state[i] == CELL_FREE) e.var[i] = ++num_vars;
+    resize_vars(s, num_vars);
+    ensure_var_info(s, num_vars);
+    for (size_t i = 0; i < cells * (size_t)N; i++)
+        if (e.state[i] == CELL_FREE)
+            s->var_info[e.var[i]] = (VarEntry){ (int)(i / N / N) + 1,
+                                                (int)(i / N % N) + 1,
+                                                (int)(i % N) + 1 };
+    s->N = N;
+    for (int r = 0; r < N; r++)
+        for (int c = 0; c < N; c++)
+            if (grid[r * N + c]) push_fixed(s, r + 1, c + 1, grid[r * N + c]);
+    if (N <= BOARD_MAX && s->ok) {
+        for (size_t i = 0; i < cells; i++) s->board[i] = (unsigned char)grid[i];
+        s->board_n = N;
+    }
+    arena_reserve(s, (size_t)4 * cells * (size_t)CLAUSE_WORDS(N));
+
+    /* ── clauses, in sudoku_to_cnf.py's order ────────────────────────────── */
+    for (int r = 0; r < N; r++)                          /* Cell_d */
+        for (int c = 0; c < N; c++) {
+            for (int v = 0; v < N; v++) enc_lit(&e, N, r, c, v, false);
+            enc_end(&e);
+        }
+    for (int r = 0; r < N; r++)                          /* Cell_u */
+        for (int c = 0; c < N; c++) {
+            for (int v = 0; v < N; v++) enc_lit(&e, N, r, c, v, true);
+            enc_end_amo(&e);
+        }
+    for (int kind = 0; kind < 3; kind++) {     /* Row, Col, Block: _d, _u */
+        int r, c;
+        for (int u = 0; u < N; u++)
+            for (int v = 0; v < N; v++) {
+                for (int k = 0; k < N; k++) {
+                    unit_cell(kind, box, u, k, &r, &c);
+                    enc_lit(&e, N, r, c, v, false);
+                }
+                enc_end(&e);
+            }
+        for (int u = 0; u < N; u++)
+            for (int v = 0; v < N; v++) {
+                for (int k = 0; k < N; k++) {
+                    unit_cell(kind, box, u, k, &r, &c);
+                    enc_lit(&e, N, r, c, v, true);
+                }
+                enc_end_amo(&e);
+            }
+    }
+
+    free(e.state);
+    free(e.var);
+    free(e.lits);
+}
+
+/* the board sizes Puzzles/ holds, each compiled for its constant N */
+#define ENCODE_BOARD_FOR(n, b)                                              \
+    static void encode_board_##n(Solver *s, int *grid) {                    \
+        uint64_t cand[n * n];                                               \
+        int      unit[3 * n * n];                                           \
+        encode_board(s, grid, n, b, cand, unit);                            \
+    }
+ENCODE_BOARD_FOR(4, 2)
+ENCODE_BOARD_FOR(9, 3)
+ENCODE_BOARD_FOR(16, 4)
+ENCODE_BOARD_FOR(25, 5)
+ENCODE_BOARD_FOR(36, 6)
+
+static void encode_board_any(Solver *s, int *grid, int N, int box) {
+    size_t    cells = (size_t)N * (size_t)N;
+    uint64_t *cand  = NULL;                  /* no rules past 64 values */
+    int      *unit  = NULL;
+    if (N <= 64) {
+        cand = malloc(cells * sizeof(uint64_t));
+        unit = malloc(3 * cells * sizeof(int));
+        if (!cand || !unit) { fprintf(stderr, "OOM: sudoku rules\n"); exit(1); }
+    }
+    encode_board(s, grid, N, box, cand, unit);
+    free(cand);
+    free(unit);
+}
+
+/*
+ * The givens of a puzzle file, row by row with 0 for an open cell, and its
+ * N and box width; NULL if it is malformed.  The caller frees the grid.
+ */
+static int *parse_puzzle(const char *buf, size_t len, int *n_out, int *box_out) {
+    const char *p = buf, *end = buf + len;
+    int N = 0;
+    skip_blanks(&p, end);
+    p += 4;                                              /* "SIZE" */
+    if (!scan_int(&p, end, &N) || N < 1 || N > 1024) return NULL;
+    int box = 1;
+    while (box * box < N) box++;
+    if (box * box != N) return NULL;
+
+    skip_line(&p, end);
+    while (p < end) {                                    /* up to PUZZLE */
+        skip_blanks(&p, end);
+        bool found = match_line(p, end, "PUZZLE", 6);
+        skip_line(&p, end);
+        if (found) break;
+    }
+
+    size_t cells = (size_t)N * (size_t)N;
+    int   *grid  = malloc(cells * sizeof(int));
+    if (!grid) { fprintf(stderr, "OOM: puzzle grid\n"); exit(1); }
+    for (size_t i = 0; i < cells; i++) {
+        while (p < end && (*p == '\n' || *p == ' ' || *p == '\t' || *p == '\r'))
+            p++;
+        if (!scan_int(&p, end, &grid[i]) || grid[i] < 0 || grid[i] > N) {
+            free(grid);
+            return NULL;
+        }
+    }
+    *n_out   = N;
+    *box_out = box;
+    return grid;
+}
+
+static bool encode_puzzle(Solver *s, const char *buf, size_t len) {
+    int  N, box;
+    int *grid = parse_puzzle(buf, len, &N, &box);
+    if (!grid) return false;
+
+    switch (N) {
+    case 4:  encode_board_4(s, grid);  break;
+    case 9:  encode_board_9(s, grid);  break;
+    case 16: encode_board_16(s, grid); break;
+    case 25: encode_board_25(s, grid); break;
+    case 36: encode_board_36(s, grid); break;
+    default: encode_board_any(s, grid, N, box);
+    }
+    free(grid);
+    return true;
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Binary instance format (.cnfb) and parse cache                             */
+/*                                                                            */
+/*  A .cnfb file is the parsed instance laid out for a single mmap:          */
+/*                                                                            */
+/*      CnfbHeader                                                            */
+/*      int32  lits[num_lits]             clause literals, back to back       */
+/*      uint32 offsets[num_clauses + 1]   clause i is lits[off[i]..off[i+1])  */
+/*      VarEntry var_info[var_info_len]   (r,c,v) per DIMACS variable         */
+/*      int32  fixed[3 * fixed_count]     (r,c,v) triples of the givens       */
+/*      int32  amo_lits[amo_len]          at-most-one group literals          */
+/*      uint32 amo_offsets[num_amo + 1]   group g, like the clause offsets    */
+/*                                                                            */
+/*  Everything is native-endian; the byte-order mark rejects a file written  */
+/*  on another architecture.  A cache file X.cnfb next to X.cnf records the  */
+/*  size and mtime of its source and is ignored once they stop matching.     */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+#define CNFB_MAGIC    "CNFB"
+#define CNFB_VERSION  2
+#define CNFB_BOM      0x01020304u
+
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint32_t bom;
+    int32_t  num_vars;
+    int32_t  num_clauses;
+    int32_t  size_n;          /* c SIZE, or 0                                */
+    int32_t  var_info_len;
+    int32_t  fixed_count;
+    int32_t  num_amo;
+    int32_t  amo_len;
+    int64_t  num_lits;
+    int64_t  src_size;        /* cache validation, 0 if not a cache          */
+    int64_t  src_mtime;
+} CnfbHeader;
+
+static bool is_cnfb(const char *buf, size_t len) {
+    return len >= sizeof(CnfbHeader) && memcmp(buf, CNFB_MAGIC, 4) == 0;
+}
+
+/* Loads a mapped .cnfb image.  Returns false if it is damaged or foreign. */
+static bool load_cnfb(Solver *s, const char *buf, size_t len) {
+    if (!is_cnfb(buf, len)) return false;
+    CnfbHeader h;
+    memcpy(&h, buf, sizeof h);
+    if (h.version != CNFB_VERSION || h.bom != CNFB_BOM ||
+        h.num_vars < 0 || h.num_clauses < 0 || h.num_lits < 0 ||
+        h.var_info_len < 0 || h.fixed_count < 0 || h.num_amo < 0 ||
+        h.amo_len < 0)
+        return false;
+
+    size_t need = sizeof h + (size_t)h.num_lits * sizeof(int32_t)
+                + ((size_t)h.num_clauses + 1) * sizeof(uint32_t)
+                + (size_t)h.var_info_len * sizeof(VarEntry)
+                + (size_t)h.fixed_count * 3 * sizeof(int32_t)
+                + (size_t)h.amo_len * sizeof(int32_t)
+                + ((size_t)h.num_amo + 1) * sizeof(uint32_t);
+    if (need != len) return false;
+
+    const int32_t  *lits = (const int32_t *)(buf + sizeof h);
+    const uint32_t *offs = (const uint32_t *)(lits + h.num_lits);
+    const VarEntry *vi   = (const VarEntry *)(offs + h.num_clauses + 1);
+    const int32_t  *fx   = (const int32_t *)(vi + h.var_info_len);
+    const int32_t  *al   = fx + 3 * (size_t)h.fixed_count;
+    const uint32_t *aoff = (const uint32_t *)(al + h.amo_len);
+
+    /* the solver trusts its clauses, so check them once here */
+    for (int64_t i = 0; i < h.num_lits; i++)
+        if (lits[i] == 0 || absval(lits[i]) > h.num_vars) return false;
+    for (int i = 0; i < h.num_clauses; i++)
+        if (offs[i] > offs[i + 1] || offs[i + 1] > (uint64_t)h.num_lits)
+            return false;
+    if (offs[0] != 0) return false;
+    for (int i = 0; i < h.amo_len; i++)
+        if (al[i] == 0 || absval(al[i]) > h.num_vars) return false;
+    for (int g = 0; g < h.num_amo; g++)
+        if (aoff[g] > aoff[g + 1] || aoff[g + 1] > (uint32_t)h.amo_len)
+            return false;
+    if (aoff[0] != 0) return false;
+
+    resize_vars(s, h.num_vars);
+    arena_reserve(s, (size_t)h.num_clauses * (size_t)CLAUSE_WORDS(0) +
+                  (size_t)h.num_lits);
+    for (int i = 0; i < h.num_clauses; i++)
+        add_clause(s, lits + offs[i], (int)(offs[i + 1] - offs[i]), false);
+    for (int g = 0; g < h.num_amo; g++)
+        add_amo(s, al + aoff[g], (int)(aoff[g + 1] - aoff[g]));
+
+    s->N = h.size_n;
+    if (h.var_info_len > 0) {
+        ensure_var_info(s, h.var_info_len - 1);
+        memcpy(s->var_info, vi, (size_t)h.var_info_len * sizeof(VarEntry));
+    }
+    for (int i = 0; i < h.fixed_count; i++)
+        push_fixed(s, fx[3 * i], fx[3 * i + 1], fx[3 * i + 2]);
+    return true;
+}
+
+/*
+ * Writes the currently loaded (not yet solved) instance.  Goes through a
+ * temporary file and rename() so a concurrent reader never sees half of it.
+ */
+static bool write_cnfb(Solver *s, const char *out_path, const struct stat *src) {
+    CnfbHeader h;
+    memset(&h, 0, sizeof h);
+    memcpy(h.magic, CNFB_MAGIC, 4);
+    h.version      = CNFB_VERSION;
+    h.bom          = CNFB_BOM;
+    h.num_vars     = s->num_vars;
+    h.size_n       = s->N;
+    h.var_info_len = s->var_info_cap;
+    h.fixed_count  = s->fixed_count;
+    h.num_amo      = s->num_amo;
+    h.amo_len      = s->amo_len;
+    h.src_size     = src ? (int64_t)src->st_size  : 0;
+    h.src_mtime    = src ? (int64_t)src->st_mtime : 0;
+    int arena_clauses = 0;
+    for (size_t cr = 0; cr < s->arena_size;
+         cr += (size_t)CLAUSE_WORDS(clause_at(s, (CRef)cr)->size)) {
+        h.num_lits += clause_at(s, (CRef)cr)->size;
+        arena_clauses++;
+    }
+    h.num_clauses  = arena_clauses + binaries_count(s);
+    h.num_lits    += 2 * (int64_t)(h.num_clauses - arena_clauses);
+
+    size_t plen = strlen(out_path);
+    char  *tmp  = malloc(plen + 5);
+    if (!tmp) return false;
+    memcpy(tmp, out_path, plen);
+    memcpy(tmp + plen, ".tmp", 5);
+
+    FILE *f = fopen(tmp, "wb");
+    if (!f) { free(tmp); return false; }
+
+    bool ok = fwrite(&h, sizeof h, 1, f) == 1;
+    for (size_t cr = 0; ok && cr < s->arena_size;
+         cr += (size_t)CLAUSE_WORDS(clause_at(s, (CRef)cr)->size)) {
+        Clause *c = clause_at(s, (CRef)cr);
+        ok = fwrite(c->lits, sizeof(int32_t), (size_t)c->size, f) == (size_t)c->size;
+    }
+    for (int w = 2; ok && w < 2 * s->num_vars + 2; w++)
+        for (int k = 0; ok && k < s->bins[w].size; k++) {
+            int32_t b[2] = { index_lit(w), s->bins[w].lits[k] };
+            if (w < watch_index(b[1])) ok = fwrite(b, sizeof b, 1, f) == 1;
+        }
+    uint32_t off = 0;
+    for (size_t cr = 0; ok && cr < s->arena_size;
+         cr += (size_t)CLAUSE_WORDS(clause_at(s, (CRef)cr)->size)) {
+        ok  = fwrite(&off, sizeof off, 1, f) == 1;
+        off += (uint32_t)clause_at(s, (CRef)cr)->size;
+    }
+    for (int i = arena_clauses; ok && i < h.num_clauses; i++, off += 2)
+        ok = fwrite(&off, sizeof off, 1, f) == 1;
+    if (ok) ok = fwrite(&off, sizeof off, 1, f) == 1;
+    if (ok && s->var_info_cap > 0)
+        ok = fwrite(s->var_info, sizeof(VarEntry), (size_t)s->var_info_cap, f) ==
+             (size_t)s->var_info_cap;
+    if (ok && s->fixed_count > 0)
+        ok = fwrite(s->fixed_flat, 3 * sizeof(int32_t), (size_t)s->fixed_count, f) ==
+             (size_t)s->fixed_count;
+    if (ok && s->amo_len > 0)
+        ok = fwrite(s->amo_lits, sizeof(int32_t), (size_t)s->amo_len, f) ==
+             (size_t)s->amo_len;
+    for (int g = 0; ok && g <= s->num_amo; g++) {
+        uint32_t a = g < s->amo_start_len ? (uint32_t)s->amo_start[g] : 0;
+        ok = fwrite(&a, sizeof a, 1, f) == 1;
+    }
+
+    if (fclose(f) != 0) ok = false;
+    if (ok) ok = rename(tmp, out_path) == 0;
+    if (!ok) remove(tmp);
+    free(tmp);
+    return ok;
+}
+
+/* X.cnf -> X.cnfb (caller frees) */
+static char *cache_path_for(const char *path) {
+    size_t n = strlen(path);
+    char  *c = malloc(n + 2);
+    if (!c) { fprintf(stderr, "OOM: cache path\n"); exit(1); }
+    memcpy(c, path, n);
+    c[n] = 'b'; c[n + 1] = '\0';
+    return c;
+}
+
+/* does the cache file exist and describe this exact version of src? */
+static bool cache_fresh(const char *cache, const struct stat *src) {
+    int fd = open(cache, O_RDONLY);
+    if (fd < 0) return false;
+    CnfbHeader h;
+    bool ok = read(fd, &h, sizeof h) == (ssize_t)sizeof h &&
+              memcmp(h.magic, CNFB_MAGIC, 4) == 0 &&
+              h.version == CNFB_VERSION && h.bom == CNFB_BOM &&
+              h.src_size  == (int64_t)src->st_size &&
+              h.src_mtime == (int64_t)src->st_mtime;
+    close(fd);
+    return ok;
+}
+
+/* ─── instance loading: .cnfb, cached .cnfb, puzzle text, or DIMACS ──────── */
+#define CACHE_READ   1     /* use X.cnfb when it is up to date             */
+#define CACHE_WRITE  2     /* (re)write X.cnfb after parsing the text       */
+
+#define FMT_CNFB     1
+#define FMT_PUZZLE   2
+#define FMT_DIMACS   3
+
+/*
+ * Loads an instance already in memory (the benchmark harness times this
+ * part alone).  Returns which format it was; *ok says whether it parsed.
+ */
+static int load_buffer(Solver *s, const char *buf, size_t len, bool *ok) {
+    if (is_cnfb(buf, len)) {
+        *ok = load_cnfb(s, buf, len);
+        return FMT_CNFB;
+    }
+    if (is_puzzle(buf, len)) {
+        *ok = encode_puzzle(s, buf, len);
+        return FMT_PUZZLE;
+    }
+    if ((*ok = parse_dimacs(s, buf, len))) extract_amo_groups(s);
+    return FMT_DIMACS;
+}
+
+static bool load_instance(Solver *s, const char *path, int cache_flags) {
+    struct stat st;
+    bool have_st = stat(path, &st) == 0;
+    char *cache  = cache_path_for(path);
+
+    size_t len;
+    bool   mapped;
+    char  *buf = NULL;
+    bool   from_cache = false;
+
+    if ((cache_flags & CACHE_READ) && have_st && cache_fresh(cache, &st)) {
+        buf = load_file(cache, &len, &mapped);
+        from_cache = buf != NULL;
+    }
+    if (!buf) buf = load_file(path, &len, &mapped);
+    if (!buf) {
+        fprintf(stderr, "Cannot open file: %s\n", path);
+        free(cache);
+        return false;
+    }
+
+    bool ok;
+    int  fmt = load_buffer(s, buf, len, &ok);
+    if (fmt == FMT_CNFB) {
+        if (!ok) fprintf(stderr, "Corrupt binary instance: %s\n",
+                         from_cache ? cache : path);
+    } else if (fmt == FMT_PUZZLE) {
+        /* encoding is cheaper than a cache round trip: never write one */
+        if (!ok) fprintf(stderr, "Malformed puzzle: %s\n", path);
+    } else if (!ok) {
+        fprintf(stderr, "Malformed DIMACS (no 'p cnf' header): %s\n", path);
+    } else if ((cache_flags & CACHE_WRITE) && have_st &&
+               !write_cnfb(s, cache, &st)) {
+        fprintf(stderr, "Could not write cache: %s\n", cache);
+    }
+
+    if (mapped) munmap(buf, len);
+    else        free(buf);
+    free(cache);
+    return ok;
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Solver lifecycle                                                           */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+static void solver_defaults(Solver *s) {
+    s->ok             = true;
+    s->var_inc        = 1.0;
+    s->cla_inc        = 1.0f;
+    s->next_reduce    = REDUCE_FIRST;
+    s->restart_policy = RESTART_LUBY;
+    s->preprocess     = true;
+    ((Clause *)s->bin_expl)->size  = 2;
+    ((Clause *)s->bin_confl)->size = 2;
+}
+
+static Solver *solver_new(void) {
+    Solver *s = calloc(1, sizeof *s);
+    if (!s) { fprintf(stderr, "OOM: solver\n"); exit(1); }
+    solver_defaults(s);
+    resize_vars(s, 0);
+    return s;
+}
+
+static void solver_free(Solver *s) {
+    free(s->arena);
+    free(s->learnts);
+    free(s->value);
+    free(s->vardata);
+    free(s->trail);
+    for (int i = 0; i < 2 * s->var_cap + 2; i++) free(s->watches[i].ws);
+    free(s->watches);
+    for (int i = 0; i < 2 * s->var_cap + 2; i++) free(s->bins[i].lits);
+    free(s->bins);
+    for (int i = 0; i < 2 * s->var_cap + 2; i++) free(s->amo_occ[i].ids);
+    free(s->amo_occ);
+    free(s->amo_lits);
+    free(s->amo_start);
+    free(s->activity);
+    free(s->heap);
+    free(s->heap_pos);
+    free(s->phase);
+    free(s->eliminated);
+    free(s->elim_stack);
+    free(s->lvl_stamp);
+    free(s->trail_lim);
+    free(s->seen);
+    free(s->gen_of);
+    free(s->learned);
+    free(s->an_stack);
+    free(s->an_toclear);
+    free(s->add_buf);
+    free(s->assumps);
+    free(s->failed);
+    free(s->var_info);
+    free(s->fixed_flat);
+    free(s);
+}
+
+#ifndef CDCL_NO_MAIN     /* only the portfolio and cube drivers copy solvers */
+
+/*
+ * Copies a loaded instance that has not been solved yet.  The clause arena
+ * is duplicated rather than shared because propagate() reorders literals
+ * in place; the Sudoku metadata is not copied.
+ */
+static Solver *solver_clone(const Solver *src) {
+    Solver *s = solver_new();
+    s->restart_policy = src->restart_policy;
+    s->ok             = src->ok;
+    s->budget         = src->budget;
+    resize_vars(s, src->num_vars);
+
+    arena_reserve(s, src->arena_size);
+    memcpy(s->arena, src->arena, src->arena_size * sizeof(int));
+    s->arena_size  = src->arena_size;
+    s->num_clauses = src->num_clauses;
+    for (size_t cr = 0; cr < s->arena_size;
+         cr += (size_t)CLAUSE_WORDS(clause_at(s, (CRef)cr)->size)) {
+        Clause *c = clause_at(s, (CRef)cr);
+        if (c->size < 2) continue;
+        watch_push(s, c->lits[0], (CRef)cr, c->lits[1]);
+        watch_push(s, c->lits[1], (CRef)cr, c->lits[0]);
+    }
+    for (int i = 0; i < 2 * src->num_vars + 2; i++) {
+        const BinList *from = &src->bins[i];
+        for (int k = 0; k < from->size; k++)
+            bin_push(s, &s->bins[i], from->lits[k]);
+    }
+    for (int g = 0; g < src->num_amo; g++) {
+        int first = src->amo_start[g], n = src->amo_start[g + 1] - first;
+        add_amo(s, src->amo_lits + first, n);     /* nothing assigned yet */
+    }
+
+    /* level-0 units asserted while loading */
+    size_t n = (size_t)src->num_vars + 1;
+    memcpy(s->value,      src->value,      2 * n);
+    memcpy(s->vardata,    src->vardata,    n * sizeof(VarData));
+    memcpy(s->eliminated, src->eliminated, n);
+    memcpy(s->trail,      src->trail, (size_t)src->trail_top * sizeof(int));
+    s->trail_top = src->trail_top;
+    s->qhead     = src->qhead;
+    return s;
+}
+
+#endif /* CDCL_NO_MAIN */
+
+/*
+ * The N×N grid row by row from the Sudoku metadata and the current
+ * assignment, 0 where nothing is known; the caller frees it.
+ */
+static int *decode_grid(const Solver *s) {
+    int  N    = s->N;
+    int *grid = calloc((size_t)N * (size_t)N, sizeof(int));
+    if (!grid) { fprintf(stderr, "OOM: grid\n"); exit(1); }
+
+    /* fixed (pre-assigned) cells, then every variable assigned TRUE */
+    for (int i = 0; i < s->fixed_count; i++) {
+        int r = s->fixed_flat[i*3],  c = s->fixed_flat[i*3+1],  v = s->fixed_flat[i*3+2];
+        if (r >= 1 && r <= N && c >= 1 && c <= N)
+            grid[(r-1) * N + c-1] = v;
+    }
+
+    int conflicts = 0;
+    for (int var = 1; var <= s->num_vars; var++) {
+        if (var_value(s, var) != 1) continue;
+        if (var >= s->var_info_cap)          continue;
+
+        const VarEntry *e = &s->var_info[var];
+        if (e->r < 1 || e->r > N || e->c < 1 || e->c > N || e->v < 1) continue;
+
+        int *cell = &grid[(e->r - 1) * N + e->c - 1];
+        if (*cell != 0 && *cell != e->v) {
+            fprintf(stderr,
+                "DECODE CONFLICT cell(%d,%d): existing=%d new=%d var=%d\n",
+                e->r, e->c, *cell, e->v, var);
+            conflicts++;
+        }
+        *cell = e->v;
+    }
+    if (conflicts)
+        fprintf(stderr, "WARNING: %d decode conflicts detected.\n", conflicts);
+    return grid;
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Solution counting (--count, cdcl_count)                                    */
+/*                                                                            */
+/*  After each model a clause excluding it goes in at level 0 and the same   */
+/*  solver searches again with everything it has learned.  For a grid the    */
+/*  clause negates the true cell variables, the ones var_info describes:     */
+/*  two solutions differ in some cell, so one of those variables is false   */
+/*  in the other, and the clause is no longer than the board has open       */
+/*  cells.  Without Sudoku metadata it covers every variable.  simplify()   */
+/*  must not run first, since eliminated variables are not searched.        */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+/*
+ * Models found, at most limit.  *last is the answer of the final search:
+ * SAT if the limit cut the count short, UNSAT if there are no others, or
+ * UNKNOWN if a budget or the terminate callback stopped it.  on_model, if
+ * set, sees each model while it is on the trail.  The excluding clauses
+ * stay in the solver.
+ */
+static int count_models(Solver *s, int limit, int *last,
+                        void (*on_model)(Solver *, int, void *), void *data) {
+    bool cells = s->var_info_cap > 0;
+    int  found = 0;
+    *last = SAT;
+    while (found < limit) {
+        *last = solve(s);
+        if (*last != SAT) break;
+        if (on_model) on_model(s, ++found, data);
+        else          ++found;
+
+        int *block = s->learned, n = 0;   /* analysis is idle between solves */
+        for (int v = 1; v <= s->num_vars; v++) {
+            int val = var_value(s, v);
+            if (cells) {
+                if (val != 1 || v >= s->var_info_cap || s->var_info[v].r == 0)
+                    continue;
+            } else if (val == UNASSIGNED) {
+                continue;
+            }
+            block[n++] = val ? -v : v;
+        }
+        backtrack(s, 0);
+        add_clause(s, block, n, false);
+    }
+    return found;
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Incremental interface (IPASIR, see ipasir.h)                               */
+/*                                                                            */
+/*  One loaded encoding answers many queries: clauses may be added between   */
+/*  solves, and everything learned so far — clauses, activities, phases —   */
+/*  carries over to the next call.  Assumptions hold for one solve only.     */
+/*  Link against this file with -DCDCL_NO_MAIN to drop the command line.     */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+const char *ipasir_signature(void) {
+    return "cdcl_implementation (Sudoku_SAT)";
+}
+
+void *ipasir_init(void) {
+    return solver_new();
+}
+
+void ipasir_release(void *solver) {
+    solver_free(solver);
+}
+
+void ipasir_add(void *solver, int32_t lit) {
+    Solver *s = solver;
+    if (lit != 0) {
+        if (absval(lit) > s->num_vars) resize_vars(s, absval(lit));
+        push_int(&s->add_buf, &s->add_len, &s->add_cap, lit, "add_buf");
+        return;
+    }
+    backtrack(s, 0);           /* original clauses go in at level 0 */
+    add_clause(s, s->add_buf, s->add_len, false);
+    s->add_len = 0;
+}
+
+void ipasir_assume(void *solver, int32_t lit) {
+    Solver *s = solver;
+    if (absval(lit) > s->num_vars) resize_vars(s, absval(lit));
+    push_int(&s->assumps, &s->num_assumps, &s->assumps_cap, lit, "assumps");
+}
+
+int ipasir_solve(void *solver) {
+    return solve(solver);
+}
+
+int32_t ipasir_val(void *solver, int32_t lit) {
+    Solver *s = solver;
+    int     v = absval(lit);
+    if (v > s->num_vars || var_value(s, v) == UNASSIGNED) return 0;
+    return var_value(s, v) ? v : -v;
+}
+
+int ipasir_failed(void *solver, int32_t lit) {
+    Solver *s = solver;
+    for (int i = 0; i < s->num_failed; i++)
+        if (s->failed[i] == lit) return 1;
+    return 0;
+}
+
+void ipasir_set_terminate(void *solver, void *data,
+                          int (*terminate)(void *data)) {
+    Solver *s = solver;
+    s->term_data = data;
+    s->terminate = terminate;
+}
+
+void ipasir_set_learn(void *solver, void *data, int max_length,
+                      void (*learn)(void *data, int32_t *clause)) {
+    Solver *s = solver;
+    s->learn_data = data;
+    s->learn_max  = max_length;
+    s->learn      = learn;
+}
+
+/* not part of IPASIR: budgets for every later solve, 0 for none */
+void cdcl_set_limits(void *solver, double seconds, long conflicts,
+                     long megabytes) {
+    Solver *s = solver;
+    s->budget.time_ms   = seconds > 0 ? seconds * 1e3 : 0;
+    s->budget.conflicts = conflicts > 0 ? conflicts : 0;
+    s->budget.mem_bytes = megabytes > 0 ? (size_t)megabytes << 20 : 0;
+}
+
+/* not part of IPASIR: loads a .cnf/.cnfb file (and its Sudoku comments) */
+int cdcl_load(void *solver, const char *path) {
+    return load_instance(solver, path, CACHE_READ);
+}
+
+/* not part of IPASIR: the same from memory, puzzle text included */
+int cdcl_load_buffer(void *solver, const char *buf, size_t len) {
+    bool ok;
+    load_buffer(solver, buf, len, &ok);
+    return ok;
+}
+
+/* not part of IPASIR: whole 0-terminated clauses at once */
+void cdcl_add_clauses(void *solver, const int32_t *lits, size_t len) {
+    Solver *s     = solver;
+    size_t  start = 0;
+    backtrack(s, 0);
+    for (size_t i = 0; i < len; i++) {
+        if (lits[i] != 0) {
+            if (absval(lits[i]) > s->num_vars) resize_vars(s, absval(lits[i]));
+            continue;
+        }
+        add_clause(s, (const int *)lits + start, (int)(i - start), false);
+        start = i + 1;
+    }
+    for (size_t i = start; i < len; i++) ipasir_add(s, lits[i]);  /* open */
+}
+
+int cdcl_num_vars(void *solver) {
+    return ((Solver *)solver)->num_vars;
+}
+
+/* not part of IPASIR: ipasir_val() of variables 1..n into model[0..n) */
+int cdcl_model(void *solver, int32_t *model, int n) {
+    Solver *s = solver;
+    if (n > s->num_vars) n = s->num_vars;
+    for (int v = 1; v <= n; v++) model[v - 1] = ipasir_val(s, v);
+    return n;
+}
+
+/* not part of IPASIR: count_models() without the callback, -1 if stopped */
+int cdcl_count(void *solver, int limit) {
+    int last, found = count_models(solver, limit, &last, NULL, NULL);
+    return last == UNKNOWN ? -1 : found;
+}
+
+/* not part of IPASIR: the board size, and with grid the N×N solution */
+int cdcl_grid(void *solver, int32_t *grid) {
+    Solver *s = solver;
+    if (s->N <= 0 || !grid) return s->N > 0 ? s->N : 0;
+    int *g = decode_grid(s);
+    for (int i = 0; i < s->N * s->N; i++) grid[i] = g[i];
+    free(g);
+    return s->N;
+}
+
+#ifndef CDCL_NO_MAIN
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* CNF simplification (before search)                                         */
+/*                                                                            */
+/*  simplify() takes the original clauses out of the arena and runs          */
+/*    - removal of satisfied clauses and false literals at level 0,          */
+/*    - backward subsumption and self-subsuming resolution,                  */
+/*    - bounded variable elimination: v goes if resolving its positive       */
+/*      against its negative clauses yields no more clauses than it removes, */
+/*    - failed-literal probing from the literals with binary implications,   */
+/*  then rebuilds the arena from what is left.  Units found on the way are   */
+/*  propagated through the at-most-one groups, whose variables are never     */
+/*  eliminated.  The clauses of an eliminated variable go on elim_stack,     */
+/*  and extend_model() uses them to complete a model.                        */
+/*                                                                            */
+/*  One-shot only: a later clause or assumption could mention a variable   */
+/*  that no longer exists, so only the command-line driver calls this.      */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+#define ELIM_OCC_LIMIT  16       /* skip variables with more clauses per sign */
+#define ELIM_RES_LIMIT  24       /* ... or a resolvent longer than this       */
+#define SUBSUME_LIMIT   20000000 /* literal visits per subsumption round      */
+#define PROBE_LIMIT     20000    /* failed-literal probes                     */
+
+typedef struct {
+    int     *lits;
+    int      size;
+    uint64_t sig;                /* bit var % 64 per literal, for subset tests */
+    bool     removed;
+    bool     queued;
+} SClause;
+
+typedef struct {
+    Solver  *s;
+    SClause *cls;
+    int      num, cap;
+    OccList *occ;        /* [watch_index(lit)] clauses containing lit; may   */
+                         /* hold removed clauses, never stale literals       */
+    int     *queue;      /* clauses still to be tried as subsumers           */
+    int      qlen, qcap;
+    int     *mark;       /* [watch_index(lit)] == stamp: lit in C            */
+    int      stamp;
+    int      units_done; /* trail[0..units_done) applied to the clauses      */
+    long     budget;
+} Simp;
+
+static uint64_t clause_sig(const int *lits, int size) {
+    uint64_t sig = 0;
+    for (int i = 0; i < size; i++) sig |= 1ull << (absval(lits[i]) & 63);
+    return sig;
+}
+
+static void simp_queue(Simp *sp, int ci) {
+    if (sp->cls[ci].queued) return;
+    sp->cls[ci].queued = true;
+    push_int(&sp->queue, &sp->qlen, &sp->qcap, ci, "simplify queue");
+}
+
+/* lits must be free of duplicates, tautologies and assigned literals */
+static int simp_add(Simp *sp, const int *lits, int size) {
+    if (sp->num >= sp->cap) {
+        sp->cap = sp->cap ? sp->cap * 2 : 1024;
+        sp->cls = realloc(sp->cls, (size_t)sp->cap * sizeof(SClause));
+        if (!sp->cls) { fprintf(stderr, "OOM: simplify\n"); exit(1); }
+    }
+    int     ci = sp->num++;
+    SClause *c = &sp->cls[ci];
+    c->lits = malloc((size_t)size * sizeof(int));
+    if (!c->lits) { fprintf(stderr, "OOM: simplify\n"); exit(1); }
+    memcpy(c->lits, lits, (size_t)size * sizeof(int));
+    c->size    = size;
+    c->sig     = clause_sig(lits, size);
+    c->removed = false;
+    c->queued  = false;
+    for (int i = 0; i < size; i++) occ_push(&sp->occ[watch_index(lits[i])], ci);
+    simp_queue(sp, ci);
+    return ci;
+}
+
+/* adds a clause of the solver, without duplicate or level-0 false literals */
+static void simp_take(Simp *sp, const int *lits, int size, int *buf) {
+    int  n   = 0;
+    bool sat = false;
+    sp->stamp++;
+    for (int i = 0; i < size && !sat; i++) {
+        int l = lits[i], v = lit_value(sp->s, l);
+        if (v == 1 || sp->mark[watch_index(-l)] == sp->stamp) sat = true;
+        else if (v == UNASSIGNED && sp->mark[watch_index(l)] != sp->stamp) {
+            sp->mark[watch_index(l)] = sp->stamp;
+            buf[n++] = l;
+        }
+    }
+    if (!sat) simp_add(sp, buf, n);
+}
+
+static void simp_remove(Simp *sp, int ci) {
+    sp->cls[ci].removed = true;
+    free(sp->cls[ci].lits);
+    sp->cls[ci].lits = NULL;
+}
+
+static int occ_count(Simp *sp, int lit) {
+    OccList *ol = &sp->occ[watch_index(lit)];
+    int j = 0;
+    for (int k = 0; k < ol->size; k++)                 /* compacts as it counts */
+        if (!sp->cls[ol->ids[k]].removed) ol->ids[j++] = ol->ids[k];
+    return ol->size = j;
+}
+
+static void simp_unit(Simp *sp, int lit) {
+    Solver *s = sp->s;
+    int v = lit_value(s, lit);
+    if (v == 0) { s->ok = false; return; }
+    if (v == UNASSIGNED) assign(s, lit, 0, CREF_NONE);
+}
+
+/* drop lit from clause ci, which stays in every other occurrence list */
+static void simp_strengthen(Simp *sp, int ci, int lit) {
+    SClause *c = &sp->cls[ci];
+    int j = 0;
+    for (int i = 0; i < c->size; i++)
+        if (c->lits[i] != lit) c->lits[j++] = c->lits[i];
+    c->size = j;
+    c->sig  = clause_sig(c->lits, c->size);
+    OccList *ol = &sp->occ[watch_index(lit)];
+    for (int k = 0; k < ol->size; k++)
+        if (ol->ids[k] == ci) { ol->ids[k] = ol->ids[--ol->size]; break; }
+    if (c->size == 0)      sp->s->ok = false;
+    else if (c->size == 1) { simp_unit(sp, c->lits[0]); simp_remove(sp, ci); }
+    else                   simp_queue(sp, ci);
+}
+
+/*
+ * Applies the level-0 trail to the clauses, after letting the at-most-one
+ * groups extend it; the arena is empty by now, so propagate() sees only them.
+ */
+static void simp_propagate(Simp *sp) {
+    Solver *s = sp->s;
+    while (s->ok && sp->units_done < s->trail_top) {
+        if (propagate(s) != CREF_NONE) { s->ok = false; return; }
+        while (s->ok && sp->units_done < s->trail_top) {
+            int lit = s->trail[sp->units_done++];
+            OccList *pos = &sp->occ[watch_index(lit)];
+            for (int k = 0; k < pos->size; k++)
+                if (!sp->cls[pos->ids[k]].removed) simp_remove(sp, pos->ids[k]);
+            pos->size = 0;
+            OccList *neg = &sp->occ[watch_index(-lit)];
+            while (s->ok && neg->size > 0) {
+                int ci = neg->ids[neg->size - 1];
+                if (sp->cls[ci].removed) { neg->size--; continue; }
+                simp_strengthen(sp, ci, -lit);
+            }
+        }
+    }
+}
+
+/* ─── subsumption and self-subsuming resolution ──────────────────────────── */
+
+static void subsume_round(Simp *sp) {
+    int *cand = NULL, ncand = 0, cand_cap = 0;
+    while (sp->qlen > 0 && sp->s->ok) {
+        int ci = sp->queue[--sp->qlen];
+        sp->cls[ci].queued = false;
+        if (sp->cls[ci].removed || sp->budget < 0) continue;
+
+        /* clauses containing C must contain its rarest variable */
+        SClause *c = &sp->cls[ci];
+        int best = c->lits[0], best_n = INT_MAX;
+        for (int i = 0; i < c->size; i++) {
+            int n = sp->occ[watch_index(c->lits[i])].size +
+                    sp->occ[watch_index(-c->lits[i])].size;
+            if (n < best_n) { best_n = n; best = c->lits[i]; }
+        }
+        ncand = 0;
+        for (int sign = 1; sign >= -1; sign -= 2) {
+            OccList *ol = &sp->occ[watch_index(sign * best)];
+            for (int k = 0; k < ol->size; k++)
+                push_int(&cand, &ncand, &cand_cap, ol->ids[k], "simplify");
+        }
+
+        sp->stamp++;
+        for (int i = 0; i < c->size; i++) sp->mark[watch_index(c->lits[i])] = sp->stamp;
+        for (int k = 0; k < ncand && sp->s->ok; k++) {
+            int      di = cand[k];
+            SClause *d  = &sp->cls[di];
+            if (di == ci || d->removed || c->removed || d->size < c->size ||
+                (c->sig & ~d->sig))
+                continue;
+            sp->budget -= d->size;
+            int same = 0, flips = 0, flip = 0;
+            for (int i = 0; i < d->size && flips < 2; i++) {
+                if (sp->mark[watch_index(d->lits[i])] == sp->stamp) same++;
+                else if (sp->mark[watch_index(-d->lits[i])] == sp->stamp) {
+                    flips++;
+                    flip = d->lits[i];
+                }
+            }
+            if (same == c->size) {
+                simp_remove(sp, di);
+                sp->s->simp_subsumed++;
+            } else if (flips == 1 && same + 1 == c->size) {
+                simp_strengthen(sp, di, flip);       /* (C - ~flip) | rest */
+                sp->s->simp_strengthened++;
+            }
+        }
+        simp_propagate(sp);
+    }
+    free(cand);
+}
+
+/* ─── bounded variable elimination ───────────────────────────────────────── */
+
+/* resolvent of a and b on var into out; false if it is a tautology */
+static bool resolve(Simp *sp, const SClause *a, const SClause *b, int var,
+                    int *out, int *size) {
+    int n = 0;
+    sp->stamp++;
+    for (int i = 0; i < a->size; i++) {
+        if (absval(a->lits[i]) == var) continue;
+        if (n >= ELIM_RES_LIMIT) { *size = n + 1; return true; }
+        sp->mark[watch_index(a->lits[i])] = sp->stamp;
+        out[n++] = a->lits[i];
+    }
+    for (int i = 0; i < b->size; i++) {
+        int l = b->lits[i];
+        if (absval(l) == var || sp->mark[watch_index(l)] == sp->stamp) continue;
+        if (sp->mark[watch_index(-l)] == sp->stamp) return false;
+        if (n >= ELIM_RES_LIMIT) { *size = n + 1; return true; }
+        out[n++] = l;
+    }
+    *size = n;
+    return true;
+}
+
+/* stack record: clause literals with the pivot first, then the size */
+static void elim_push(Solver *s, const SClause *c, int pivot) {
+    push_int(&s->elim_stack, &s->elim_len, &s->elim_cap, pivot, "elim stack");
+    for (int i = 0; i < c->size; i++)
+        if (c->lits[i] != pivot)
+            push_int(&s->elim_stack, &s->elim_len, &s->elim_cap, c->lits[i],
+                     "elim stack");
+    push_int(&s->elim_stack, &s->elim_len, &s->elim_cap, c->size, "elim stack");
+}
+
+static bool try_eliminate(Simp *sp, int var, int *res, int *res_size) {
+    Solver *s = sp->s;
+    int np = occ_count(sp, var), nn = occ_count(sp, -var);
+    if (np + nn == 0 || np > ELIM_OCC_LIMIT || nn > ELIM_OCC_LIMIT) return false;
+
+    /* resolvents, back to back with their sizes, while they stay bounded */
+    OccList *pos = &sp->occ[watch_index(var)], *neg = &sp->occ[watch_index(-var)];
+    int count = 0, len = 0;
+    for (int i = 0; i < np; i++)
+        for (int j = 0; j < nn; j++) {
+            int size;
+            if (!resolve(sp, &sp->cls[pos->ids[i]], &sp->cls[neg->ids[j]], var,
+                         res + len, &size))
+                continue;
+            if (size > ELIM_RES_LIMIT || ++count > np + nn) return false;
+            res_size[count - 1] = size;
+            len += size;
+        }
+
+    for (int i = 0; i < np; i++) elim_push(s, &sp->cls[pos->ids[i]], var);
+    for (int j = 0; j < nn; j++) elim_push(s, &sp->cls[neg->ids[j]], -var);
+    for (int i = 0; i < np; i++) simp_remove(sp, pos->ids[i]);
+    for (int j = 0; j < nn; j++) simp_remove(sp, neg->ids[j]);
+    pos->size = neg->size = 0;
+    s->eliminated[var] = 1;
+    s->simp_eliminated++;
+
+    for (int r = 0, off = 0; r < count && s->ok; off += res_size[r++]) {
+        if (res_size[r] == 0) { s->ok = false; break; }
+        if (res_size[r] == 1) simp_unit(sp, res[off]);
+        else                  simp_add(sp, res + off, res_size[r]);
+    }
+    simp_propagate(sp);
+    return true;
+}
+
+static int elim_key_cmp(const void *a, const void *b) {
+    const long long *x = a, *y = b;
+    return *x < *y ? -1 : *x > *y;
+}
+
+static void eliminate_round(Simp *sp) {
+    Solver    *s    = sp->s;
+    int        n    = s->num_vars;
+    long long *keys = malloc(((size_t)n + 1) * sizeof(long long));
+    int *res      = malloc((size_t)(2 * ELIM_OCC_LIMIT + 1) * (ELIM_RES_LIMIT + 1) *
+                           sizeof(int));
+    int *res_size = malloc((size_t)(2 * ELIM_OCC_LIMIT + 1) * sizeof(int));
+    if (!keys || !res || !res_size) { fprintf(stderr, "OOM: simplify\n"); exit(1); }
+
+    /* cheapest first: fewest clauses to resolve */
+    int m = 0;
+    for (int v = 1; v <= n; v++) {
+        if (var_value(s, v) != UNASSIGNED || s->eliminated[v] ||
+            s->amo_occ[watch_index(v)].size || s->amo_occ[watch_index(-v)].size)
+            continue;
+        long long cost = (long long)occ_count(sp, v) * occ_count(sp, -v);
+        keys[m++] = cost << 32 | v;
+    }
+    qsort(keys, (size_t)m, sizeof(long long), elim_key_cmp);
+    for (int i = 0; i < m && s->ok; i++) {
+        int v = (int)(keys[i] & 0xffffffff);
+        if (var_value(s, v) == UNASSIGNED) try_eliminate(sp, v, res, res_size);
+    }
+    free(keys);
+    free(res);
+    free(res_size);
+}
+
+/* ─── failed literals ────────────────────────────────────────────────────── */
+
+/* assigns lit at a new level and propagates; returns how many literals */
+/* that fixed, or -1 on conflict.  The assignment is undone either way. */
+static int probe(Solver *s, int lit) {
+    int top = s->trail_top;
+    new_level(s);
+    assign(s, lit, s->level, CREF_NONE);
+    bool conflict = propagate(s) != CREF_NONE;
+    int  implied  = s->trail_top - top;
+    backtrack(s, s->level - 1);
+    return conflict ? -1 : implied;
+}
+
+/* probes the literals that imply something through a binary clause */
+static void probe_failed(Solver *s, Simp *sp) {
+    char *phase = malloc((size_t)s->num_vars + 1);
+    char *tried = calloc(2 * (size_t)s->num_vars + 2, 1);
+    if (!phase || !tried) { fprintf(stderr, "OOM: simplify\n"); exit(1); }
+    memcpy(phase, s->phase, (size_t)s->num_vars + 1);   /* probing sets them */
+
+    int probes = 0;
+    for (int ci = 0; ci < sp->num && s->ok && probes < PROBE_LIMIT; ci++) {
+        SClause *c = &sp->cls[ci];
+        if (c->removed || c->size != 2) continue;
+        for (int i = 0; i < 2 && s->ok; i++) {
+            int lit = -c->lits[i];                    /* lit -> other literal */
+            if (tried[watch_index(lit)] || lit_value(s, lit) != UNASSIGNED)
+                continue;
+            tried[watch_index(lit)] = 1;
+            probes++;
+            if (probe(s, lit) >= 0) continue;
+            s->simp_failed++;
+            assign(s, -lit, 0, CREF_NONE);
+            if (propagate(s) != CREF_NONE) s->ok = false;
+        }
+    }
+    memcpy(s->phase, phase, (size_t)s->num_vars + 1);
+    free(phase);
+    free(tried);
+}
+
+/* ─── driver ─────────────────────────────────────────────────────────────── */
+
+static void simplify(Solver *s) {
+    backtrack(s, 0);
+    if (!s->ok || propagate(s) != CREF_NONE) { s->ok = false; return; }
+
+    Simp sp;
+    memset(&sp, 0, sizeof sp);
+    sp.s      = s;
+    sp.budget = SUBSUME_LIMIT;
+    sp.occ    = calloc(2 * (size_t)s->num_vars + 2, sizeof(OccList));
+    sp.mark   = calloc(2 * (size_t)s->num_vars + 2, sizeof(int));
+    int *buf  = malloc(((size_t)s->num_vars + 1) * sizeof(int));
+    if (!sp.occ || !sp.mark || !buf) { fprintf(stderr, "OOM: simplify\n"); exit(1); }
+
+    /* take the clauses out, cleaned; learned ones are simply dropped */
+    for (size_t cr = 0; cr < s->arena_size;
+         cr += (size_t)CLAUSE_WORDS(clause_at(s, (CRef)cr)->size)) {
+        Clause *c = clause_at(s, (CRef)cr);
+        if (!c->learnt && !c->deleted) simp_take(&sp, c->lits, c->size, buf);
+    }
+    for (int w = 2; w < 2 * s->num_vars + 2; w++)          /* binaries, once */
+        for (int k = 0; k < s->bins[w].size; k++) {
+            int b[2] = { index_lit(w), s->bins[w].lits[k] };
+            if (w < watch_index(b[1])) simp_take(&sp, b, 2, buf);
+        }
+    s->arena_size = 0;
+    s->arena_wasted = 0;
+    s->num_clauses = 0;
+    s->num_learnts = 0;
+    for (int i = 0; i < 2 * s->num_vars + 2; i++) s->watches[i].size = 0;
+    for (int i = 0; i < 2 * s->num_vars + 2; i++) s->bins[i].size = 0;
+    s->list_bytes = 0;
+    for (int i = 0; i < s->trail_top; i++)
+        s->vardata[absval(s->trail[i])].reason = CREF_NONE;
+    sp.units_done = s->trail_top;
+
+    /* a clause left empty or unit by level 0 was never watched this way */
+    for (int ci = 0; ci < sp.num && s->ok; ci++) {
+        SClause *c = &sp.cls[ci];
+        if (c->size == 0) s->ok = false;
+        else if (c->size == 1) { simp_unit(&sp, c->lits[0]); simp_remove(&sp, ci); }
+    }
+    simp_propagate(&sp);
+
+    subsume_round(&sp);
+    if (s->ok) eliminate_round(&sp);
+    if (s->ok) { sp.budget = SUBSUME_LIMIT; subsume_round(&sp); }
+
+    /* back into the arena */
+    for (int ci = 0; ci < sp.num; ci++) {
+        SClause *c = &sp.cls[ci];
+        if (!c->removed && s->ok) add_clause(s, c->lits, c->size, false);
+    }
+    if (s->ok && propagate(s) != CREF_NONE) s->ok = false;
+    if (s->ok) probe_failed(s, &sp);
+
+    for (int ci = 0; ci < sp.num; ci++) free(sp.cls[ci].lits);
+    free(sp.cls);
+    for (int i = 0; i < 2 * s->num_vars + 2; i++) free(sp.occ[i].ids);
+    free(sp.occ);
+    free(sp.queue);
+    free(sp.mark);
+    free(buf);
+}
+
+/*
+ * Gives the eliminated variables values that satisfy their removed clauses,
+ * last elimination first.  A variable starts false when its first record is
+ * reached, so earlier records already see it; a clause not yet satisfied by
+ * its other literals makes its pivot true.  At most one sign of a variable
+ * can need this, since the resolvents hold.
+ */
+static void extend_model(Solver *s) {
+    for (int top = s->elim_len; top > 0; ) {
+        int  size = s->elim_stack[top - 1];
+        int *c    = s->elim_stack + top - 1 - size;
+        top -= size + 1;
+        int  var  = absval(c[0]);
+        if (var_value(s, var) == UNASSIGNED) set_var_value(s, var, 0);
+        bool sat = false;
+        for (int i = 1; i < size && !sat; i++) sat = lit_value(s, c[i]) == 1;
+        if (!sat) set_var_value(s, var, c[0] > 0);
+    }
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Bitboard fast path (puzzle files up to 16x16)                              */
+/*                                                                            */
+/*  encode_puzzle() keeps the grid of a board with N <= BOARD_MAX, after    */
+/*  the Sudoku rules, in s->board, and board_solve() answers it on that     */
+/*  grid before any CDCL search.  Each row, column and box has a mask of    */
+/*  the values it uses, one bit per value, and the candidates of a cell are */
+/*  what its three masks leave.  Naked singles come from those, hidden      */
+/*  singles for all N values of a unit at once from the cells' "seen once"  */
+/*  and "seen twice" masks; when neither applies, the open cell with the    */
+/*  fewest candidates is guessed.  The solution is written back as a model  */
+/*  of the encoding, so nothing after the solve can tell the difference.    */
+/*  A board that takes more than BOARD_NODES guesses goes to the CDCL       */
+/*  search as before, and so does one whose givens clash (without the rules */
+/*  their encoding can still be satisfiable).                               */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    unsigned char grid[BOARD_MAX * BOARD_MAX];  /* value per cell, 0 if open */
+    uint32_t      used[3 * BOARD_MAX];          /* rows, columns, boxes      */
+} Bitboard;
+
+static inline int popcount32(uint32_t x) {
+#if defined(__GNUC__)
+    return __builtin_popcount(x);
+#else
+    int n = 0;
+    for (; x; x &= x - 1) n++;
+    return n;
+#endif
+}
+
+static inline int lowest_bit(uint32_t x) {
+#if defined(__GNUC__)
+    return __builtin_ctz(x);
+#else
+    int n = 0;
+    while (!(x >> n & 1)) n++;
+    return n;
+#endif
+}
+
+KERNEL uint32_t bb_cand(const Bitboard *b, int N, int box, int cell) {
+    int r = cell / N, c = cell % N;
+    uint32_t used = b->used[r] | b->used[N + c] |
+                    b->used[2 * N + r / box * box + c / box];
+    return ~used & ((1u << N) - 1);
+}
+
+/* v is 0-based; false if a row, column or box already has it */
+KERNEL bool bb_place(Bitboard *b, int N, int box, int cell, int v) {
+    int      r = cell / N, c = cell % N, k = 2 * N + r / box * box + c / box;
+    uint32_t bit = 1u << v;
+    if ((b->used[r] | b->used[N + c] | b->used[k]) & bit) return false;
+    b->grid[cell]  = (unsigned char)(v + 1);
+    b->used[r]    |= bit;
+    b->used[N + c] |= bit;
+    b->used[k]    |= bit;
+    return true;
+}
+
+/*
+ * Singles until none is left; false once a cell or a value has no room.
+ * The hidden singles work on the candidates as the naked pass left them,
+ * with a cell's mask cleared once it is filled: a placement only removes
+ * candidates elsewhere, so a value missing from a stale mask is missing
+ * for real, and bb_place() rejects the rest.
+ */
+KERNEL bool bb_propagate(Bitboard *b, int N, int box) {
+    uint32_t full = (1u << N) - 1;
+    uint32_t cand[BOARD_MAX * BOARD_MAX];
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 0; i < N * N; i++) {
+            cand[i] = 0;
+            if (b->grid[i]) continue;
+            uint32_t m = bb_cand(b, N, box, i);
+            if (!m) return false;
+            if (m & (m - 1))                        cand[i] = m;
+            else if (bb_place(b, N, box, i, lowest_bit(m))) changed = true;
+        }
+        for (int u = 0; u < 3 * N; u++) {
+            uint32_t once = 0, twice = 0;
+            for (int k = 0; k < N; k++) {
+                int r, c;
+                unit_cell(u / N, box, u % N, k, &r, &c);
+                uint32_t m = cand[r * N + c];
+                twice |= once & m;
+                once  |= m;
+            }
+            uint32_t need = full & ~b->used[u];
+            if ((once & need) != need) return false;
+            for (uint32_t single = once & ~twice & need; single;
+                 single &= single - 1) {
+                int v = lowest_bit(single);
+                for (int k = 0; k < N; k++) {
+                    int r, c;
+                    unit_cell(u / N, box, u % N, k, &r, &c);
+                    if (cand[r * N + c] >> v & 1) {
+                        if (bb_place(b, N, box, r * N + c, v)) changed = true;
+                        cand[r * N + c] = 0;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/*
+ * 1 with the solution in *b, 0 if there is none, -1 once *nodes passes
+ * BOARD_NODES.  self is this function's instance for N, for the recursion.
+ */
+KERNEL int bb_search(Bitboard *b, int N, int box, long *nodes,
+                     int (*self)(Bitboard *, long *)) {
+    if (!bb_propagate(b, N, box)) return 0;
+    int best = -1, best_n = N + 1;
+    for (int i = 0; i < N * N && best_n > 2; i++) {
+        if (b->grid[i]) continue;
+        int n = popcount32(bb_cand(b, N, box, i));
+        if (n < best_n) { best = i; best_n = n; }
+    }
+    if (best < 0) return 1;
+
+    for (uint32_t m = bb_cand(b, N, box, best); m; m &= m - 1) {
+        if (++*nodes > BOARD_NODES) return -1;
+        Bitboard t = *b;
+        bb_place(&t, N, box, best, lowest_bit(m));
+        int r = self(&t, nodes);
+        if (r == 1) *b = t;
+        if (r != 0) return r;
+    }
+    return 0;
+}
+
+#define BB_SEARCH_FOR(n, bx)                                                \
+    static int bb_search_##n(Bitboard *b, long *nodes) {                    \
+        return bb_search(b, n, bx, nodes, bb_search_##n);                   \
+    }
+BB_SEARCH_FOR(4, 2)
+BB_SEARCH_FOR(9, 3)
+BB_SEARCH_FOR(16, 4)
+
+/* SAT or UNSAT with the model set, UNASSIGNED if CDCL has to decide */
+static int board_solve(Solver *s) {
+    int N = s->board_n, box = 1;
+    if (N == 0 || !s->ok) return UNASSIGNED;
+    while (box * box < N) box++;
+
+    Bitboard b;
+    memset(&b, 0, sizeof b);
+    for (int i = 0; i < N * N; i++)
+        if (s->board[i] && !bb_place(&b, N, box, i, s->board[i] - 1))
+            return UNASSIGNED;
+
+    long nodes = 0;
+    int  r;
+    switch (N) {
+    case 4:  r = bb_search_4(&b, &nodes);  break;
+    case 9:  r = bb_search_9(&b, &nodes);  break;
+    case 16: r = bb_search_16(&b, &nodes); break;
+    default: return UNASSIGNED;
+    }
+    s->board_nodes = nodes;
+    if (r < 0)  return UNASSIGNED;
+    if (r == 0) return UNSAT;
+
+    for (int v = 1; v <= s->num_vars && v < s->var_info_cap; v++) {
+        const VarEntry *e = &s->var_info[v];
+        set_var_value(s, v, b.grid[(e->r - 1) * N + e->c - 1] == e->v);
+    }
+    return SAT;
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Print DIMACS-style result                                                  */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+static void print_result(Solver *s, int res) {
+    if (res == SAT) {
+        printf("SAT\nv ");
+        for (int i = 1; i <= s->num_vars; i++) {
+            if      (var_value(s, i) == 1) printf("%d ",  i);
+            else if (var_value(s, i) == 0) printf("-%d ", i);
+            else                                printf("%d ",  i);
+        }
+        printf("0\n");
+    } else if (res == UNSAT) {
+        printf("UNSAT\n");
+    } else {
+        printf("UNKNOWN\n");
+    }
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Decode and pretty-print the Sudoku grid                                    */
+/*                                                                            */
+/*  decode_grid() (before the IPASIR section, cdcl_grid() uses it too):     */
+/*    1. Allocate N×N grid, zero-filled.                                      */
+/*    2. Stamp in FIXED cells (pre-assigned, not in SAT variables).           */
+/*    3. For each SAT variable assigned TRUE, use var_info[] to find          */
+/*       which cell and value it represents, stamp into grid.                 */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+static void decode_and_print_sudoku(Solver *s) {
+    int N = s->N;
+    if (N <= 0) {
+        printf("(Sudoku decode skipped: no 'c SIZE N' comment found in CNF)\n");
+        return;
+    }
+    int *grid = decode_grid(s);
+
+    /* ── pretty-print ───────────────────────────────────────────────────── */
+    printf("\nSudoku solution (%dx%d):\n\n", N, N);
+
+    /* box width = smallest integer whose square >= N */
+    int base = 1;
+    while (base * base < N) base++;
+
+    for (int r = 0; r < N; r++) {
+        /* horizontal separator between box rows */
+        if (r > 0 && r % base == 0) {
+            int dashes = N * 2 + (N / base - 1) * 2;
+            for (int i = 0; i < dashes; i++) putchar('-');
+            putchar('\n');
+        }
+        for (int c = 0; c < N; c++) {
+            /* vertical separator between box columns */
+            if (c > 0 && c % base == 0) printf("| ");
+
+            int val = grid[r * N + c];
+            if      (val == 0)  printf(". ");
+            else if (val <= 9)  printf("%d ", val);
+            else                printf("%c ", 'A' + val - 10);
+        }
+        putchar('\n');
+    }
+
+    free(grid);
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Statistics (--stats, --stats-json)                                         */
+/*                                                                            */
+/*  The solver counts decisions, propagated literals, conflicts, learned     */
+/*  clauses and restarts as it goes; main() times the phases around it.     */
+/*  --stats prints them as "c stat <key> <value>" lines after the answer,    */
+/*  --stats-json=FILE writes the same keys as one JSON object, so a         */
+/*  benchmark script can tell parse time from search time without timing   */
+/*  the whole process.  Threaded modes report the sum over their workers.   */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    const char *path;
+    int    vars, clauses, groups;     /* as loaded, before simplify(s) */
+    double parse_ms, simplify_ms, solve_ms, total_ms;
+    bool   cached;                    /* answered by the puzzle cache */
+} RunStats;
+
+/* folds a worker's counters into the solver that reports them */
+static void stats_add(Solver *dst, const Solver *src) {
+    dst->decisions         += src->decisions;
+    dst->propagations      += src->propagations;
+    dst->conflicts         += src->conflicts;
+    dst->restarts          += src->restarts;
+    dst->chrono_backtracks += src->chrono_backtracks;
+    dst->reused_levels     += src->reused_levels;
+    dst->reductions        += src->reductions;
+    dst->learned_total     += src->learned_total;
+    dst->learned_lits      += src->learned_lits;
+    if (!dst->limit_hit) dst->limit_hit = src->limit_hit;
+}
+
+static void json_string(FILE *f, const char *str) {
+    fputc('"', f);
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++) {
+        if (*p == '"' || *p == '\\') fprintf(f, "\\%c", *p);
+        else if (*p < 0x20)          fprintf(f, "\\u%04x", *p);
+        else                         fputc(*p, f);
+    }
+    fputc('"', f);
+}
+
+static void print_stats(Solver *s, int res, const RunStats *rs, FILE *f,
+                        bool json) {
+    struct rusage ru;
+    long peak_kb = getrusage(RUSAGE_SELF, &ru) == 0 ? ru.ru_maxrss : 0;
+    double secs  = rs->solve_ms / 1000.0;
+    const char *answer = res == SAT ? "SAT" : res == UNSAT ? "UNSAT" : "UNKNOWN";
+
+    struct { const char *key; double val; bool integral; } rows[] = {
+        {"vars",              rs->vars,                              true},
+        {"clauses",           rs->clauses,                           true},
+        {"amo_groups",        rs->groups,                            true},
+        {"parse_ms",          rs->parse_ms,                          false},
+        {"simplify_ms",       rs->simplify_ms,                       false},
+        {"solve_ms",          rs->solve_ms,                          false},
+        {"total_ms",          rs->total_ms,                          false},
+        {"decisions",         (double)s->decisions,                  true},
+        {"propagations",      (double)s->propagations,               true},
+        {"propagations_per_sec",
+                              secs > 0 ? s->propagations / secs : 0, false},
+        {"conflicts",         (double)s->conflicts,                  true},
+        {"learned",           (double)s->learned_total,              true},
+        {"learned_avg_size",  s->learned_total ? (double)s->learned_lits /
+                                                 s->learned_total : 0, false},
+        {"restarts",          (double)s->restarts,                   true},
+        {"chrono_backtracks", (double)s->chrono_backtracks,          true},
+        {"reused_levels",     (double)s->reused_levels,              true},
+        {"reductions",        (double)s->reductions,                 true},
+        {"eliminated",        (double)s->simp_eliminated,            true},
+        {"subsumed",          (double)s->simp_subsumed,              true},
+        {"strengthened",      (double)s->simp_strengthened,          true},
+        {"failed_literals",   (double)s->simp_failed,                true},
+        {"bitboard_nodes",    (double)s->board_nodes,                true},
+        {"cache_hit",         rs->cached,                            true},
+        {"peak_rss_kb",       (double)peak_kb,                       true},
+    };
+    int n = (int)(sizeof rows / sizeof rows[0]);
+
+    if (!json) {
+        fprintf(f, "c stat %-22s %s\n", "result", answer);
+        if (s->limit_hit) fprintf(f, "c stat %-22s %s\n", "limit", s->limit_hit);
+        for (int i = 0; i < n; i++)
+            fprintf(f, rows[i].integral ? "c stat %-22s %.0f\n"
+                                        : "c stat %-22s %.2f\n",
+                    rows[i].key, rows[i].val);
+        return;
+    }
+    fprintf(f, "{\"instance\": ");
+    json_string(f, rs->path);
+    fprintf(f, ", \"result\": \"%s\", \"limit\": ", answer);
+    if (s->limit_hit) json_string(f, s->limit_hit);
+    else              fprintf(f, "null");
+    for (int i = 0; i < n; i++)
+        fprintf(f, rows[i].integral ? ", \"%s\": %.0f" : ", \"%s\": %.3f",
+                rows[i].key, rows[i].val);
+    fprintf(f, "}\n");
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Puzzle result cache (--puzzle-cache)                                       */
+/*                                                                            */
+/*  Relabelling the values, permuting the rows of a band, the bands, the      */
+/*  columns of a stack and the stacks, and transposing all turn a puzzle      */
+/*  into one whose solutions are the old ones moved the same way.  A puzzle   */
+/*  file is keyed by one canonical member of its class under those moves, so  */
+/*  equivalent puzzles share one entry, which holds the answer in canonical   */
+/*  coordinates.  A hit maps it back through the puzzle's own move and skips  */
+/*  the search (and in --batch and --serve the encoding).  Entries live in a  */
+/*  hash table and, with a file, are appended to it as they are made and      */
+/*  read back at the next start.                                              */
+/*                                                                            */
+/*  The canonical member is found the way graph canonical labelling finds     */
+/*  one.  Rows, columns, values, bands and stacks get colours refined from    */
+/*  the clues until no class splits further; a class still tied is broken by  */
+/*  trying each member in turn, and each leaf orders the grid by its          */
+/*  colours.  The least leaf, by its path's invariants and then its grid      */
+/*  with values numbered by first appearance, is the key.  A leaf equal to    */
+/*  the best so far is an automorphism, and members it joins with one         */
+/*  already tried are skipped.  A search that looks at more than CANON_WORK   */
+/*  cells gives up, and so does a puzzle whose clues clash; both are solved   */
+/*  without the cache.                                                        */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+#define CANON_MAX       64          /* largest N the cache keys (byte cells)  */
+#define CANON_WORK      (1L << 22)  /* cells one canonical search may visit   */
+#define CANON_AUTOS     64          /* automorphisms kept for pruning         */
+#define PCACHE_MAGIC    "SDKC"
+#define PCACHE_VERSION  1
+
+/* a puzzle's move onto its canonical form, and that form */
+typedef struct {
+    int            N, box;
+    bool           transposed;   /* row and col index the transposed grid   */
+    int           *row;          /* canonical row i is source row row[i]    */
+    int           *col;          /* ... and column j source column col[j]   */
+    unsigned char *label;        /* [source value] -> canonical value       */
+    unsigned char *givens;       /* the canonical puzzle, N*N               */
+} Canon;
+
+/*
+ * canon_search() state.  A level's colours are laid out rows, columns,
+ * values 0..N, bands, stacks (see CANON_*), one 64-bit colour each.
+ */
+typedef struct {
+    const int *grid;
+    int        N, box;
+    bool       t;                /* the transposed grid on this pass        */
+    int       *clue;             /* (r, c, v) triples of the oriented grid  */
+    int        num_clues;
+    bool      *empty;            /* [r] rows, [N + c] columns without clues */
+    int        span;             /* colours per level                       */
+    uint64_t  *color;            /* [depth * span + i]                      */
+    uint64_t  *next;             /* canon_refine() scratch, span            */
+    uint64_t  *sorted;
+    int       *order;            /* [depth * 2N]: rows, then columns        */
+    int       *members;          /* [depth * N]: the class branched on      */
+    int       *chosen;           /* [depth]: the member individualised      */
+    int       *autos;            /* [a * span + i]: automorphisms found     */
+    int        num_autos;
+    int       *orbit;            /* canon_search() scratch, N               */
+    uint64_t  *inv;              /* [depth]: invariants on the current path */
+    uint64_t  *best_inv;
+    int        best_depth;
+    unsigned char *vals;         /* canon_leaf() scratch                    */
+    unsigned char *lab;
+    long       version;          /* bumped whenever the best changes        */
+    long       work;
+    Canon     *best;
+} CanonSearch;
+
+#define CANON_ROW(cs)    0
+#define CANON_COL(cs)    ((cs)->N)
+#define CANON_VAL(cs)    (2 * (cs)->N)
+#define CANON_BAND(cs)   (3 * (cs)->N + 1)
+#define CANON_STACK(cs)  (3 * (cs)->N + 1 + (cs)->box)
+
+static void canon_free(Canon *cf) {
+    free(cf->row);
+    free(cf->col);
+    free(cf->label);
+    free(cf->givens);
+    memset(cf, 0, sizeof *cf);
+}
+
+static inline uint64_t mix64(uint64_t x) {                    /* splitmix64 */
+    x += 0x9e3779b97f4a7c15ull;
+    x  = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x  = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+/* distinct colours among n */
+static int canon_distinct(const uint64_t *c, int n, uint64_t *tmp) {
+    for (int i = 0; i < n; i++) {
+        uint64_t x = c[i];
+        int      k = i;
+        for (; k > 0 && tmp[k - 1] > x; k--) tmp[k] = tmp[k - 1];
+        tmp[k] = x;
+    }
+    int d = n > 0;
+    for (int i = 1; i < n; i++) d += tmp[i] != tmp[i - 1];
+    return d;
+}
+
+static int canon_classes(CanonSearch *cs, const uint64_t *c) {
+    int N = cs->N, b = cs->box;
+    return canon_distinct(c + CANON_ROW(cs),   N,     cs->sorted) +
+           canon_distinct(c + CANON_COL(cs),   N,     cs->sorted) +
+           canon_distinct(c + CANON_VAL(cs),   N + 1, cs->sorted) +
+           canon_distinct(c + CANON_BAND(cs),  b,     cs->sorted) +
+           canon_distinct(c + CANON_STACK(cs), b,     cs->sorted);
+}
+
+/*
+ * Recolours every row, column, value, band and stack from its colour and
+ * the colours of what it meets, until no class splits.  Only the multiset
+ * of what an item meets enters its colour, so the result does not depend
+ * on how the puzzle was written down.
+ */
+static void canon_refine(CanonSearch *cs, uint64_t *c) {
+    int       N = cs->N, b = cs->box;
+    uint64_t *n = cs->next;
+    int       classes = canon_classes(cs, c);
+    for (;;) {
+        for (int i = 0; i < N; i++) {
+            n[CANON_ROW(cs) + i] = mix64(c[CANON_ROW(cs) + i] +
+                                         3 * c[CANON_BAND(cs) + i / b]);
+            n[CANON_COL(cs) + i] = mix64(c[CANON_COL(cs) + i] +
+                                         5 * c[CANON_STACK(cs) + i / b]);
+        }
+        for (int v = 0; v <= N; v++) n[CANON_VAL(cs) + v] = mix64(c[CANON_VAL(cs) + v]);
+        for (int i = 0; i < cs->num_clues; i++) {
+            int r = cs->clue[3 * i], col = cs->clue[3 * i + 1], v = cs->clue[3 * i + 2];
+            uint64_t rc = c[CANON_ROW(cs) + r], cc = c[CANON_COL(cs) + col],
+                     vc = mix64(c[CANON_VAL(cs) + v]);
+            n[CANON_ROW(cs) + r]   += mix64(cc ^ vc);
+            n[CANON_COL(cs) + col] += mix64(rc ^ vc ^ 1);
+            n[CANON_VAL(cs) + v]   += mix64(rc * 31 + cc);
+        }
+        for (int g = 0; g < b; g++) {
+            uint64_t band  = mix64(c[CANON_BAND(cs) + g]),
+                     stack = mix64(c[CANON_STACK(cs) + g]);
+            for (int k = g * b; k < g * b + b; k++) {
+                band  += mix64(c[CANON_ROW(cs) + k]);
+                stack += mix64(c[CANON_COL(cs) + k]);
+            }
+            n[CANON_BAND(cs) + g]  = band;
+            n[CANON_STACK(cs) + g] = stack;
+        }
+        memcpy(c, n, (size_t)cs->span * sizeof(uint64_t));
+        cs->work += cs->num_clues + cs->span;
+        int now = canon_classes(cs, c);
+        if (now <= classes) break;
+        classes = now;
+    }
+}
+
+/*
+ * Rows (cols: columns) in canonical order: bands by colour, then the rows
+ * of each by colour.  Items left tied keep their index order.
+ */
+static void canon_order(CanonSearch *cs, const uint64_t *c, bool cols, int *out) {
+    int b = cs->box;
+    const uint64_t *item  = c + (cols ? CANON_COL(cs)   : CANON_ROW(cs));
+    const uint64_t *group = c + (cols ? CANON_STACK(cs) : CANON_BAND(cs));
+    int groups[CANON_MAX];
+    for (int g = 0; g < b; g++) {
+        int k = g;
+        for (; k > 0 && group[groups[k - 1]] > group[g]; k--) groups[k] = groups[k - 1];
+        groups[k] = g;
+    }
+    for (int i = 0; i < b; i++) {
+        int *o = out + i * b;
+        for (int m = 0; m < b; m++) {
+            int x = groups[i] * b + m, k = m;
+            for (; k > 0 && item[o[k - 1]] > item[x]; k--) o[k] = o[k - 1];
+            o[k] = x;
+        }
+    }
+}
+
+/*
+ * The first class, in canonical order, whose order is still open and
+ * matters: tied bands, tied rows of a band, then the same for stacks and
+ * columns.  Tied items without clues are interchangeable and never
+ * branched on.  Returns its size, 0 once the order is complete.
+ */
+static int canon_target(CanonSearch *cs, const uint64_t *c, const int *order,
+                        int *members) {
+    int N = cs->N, b = cs->box;
+    for (int side = 0; side < 2; side++) {
+        const int      *o     = order + side * N;
+        const bool     *empty = cs->empty + side * N;
+        const uint64_t *item  = c + (side ? CANON_COL(cs)   : CANON_ROW(cs));
+        const uint64_t *group = c + (side ? CANON_STACK(cs) : CANON_BAND(cs));
+        int base = side ? CANON_STACK(cs) : CANON_BAND(cs);
+        for (int i = 0; i < b; ) {                          /* bands */
+            int g = o[i * b] / b, n = 0, clues = 0;
+            for (int k = g * b; k < g * b + b; k++) clues += !empty[k];
+            for (int j = i; j < b && group[o[j * b] / b] == group[g]; j++)
+                members[n++] = base + o[j * b] / b;
+            if (n > 1 && clues) return n;
+            i += n;
+        }
+        base = side ? CANON_COL(cs) : CANON_ROW(cs);
+        for (int i = 0; i < N; ) {                          /* rows */
+            int n = 0;
+            for (int j = i; j < N && j / b == i / b && item[o[j]] == item[o[i]]; j++)
+                members[n++] = base + o[j];
+            if (n > 1 && !empty[o[i]]) return n;
+            i += n;
+        }
+    }
+    return 0;
+}
+
+static uint64_t canon_invariant(CanonSearch *cs, const uint64_t *c,
+                                const int *order, bool leaf) {
+    int      N = cs->N, b = cs->box;
+    uint64_t h = leaf, vals = 0;
+    for (int i = 0; i < N; i++) {
+        h = mix64(h ^ c[CANON_ROW(cs) + order[i]]);
+        h = mix64(h ^ c[CANON_COL(cs) + order[N + i]]);
+    }
+    for (int g = 0; g < b; g++) {
+        h = mix64(h ^ c[CANON_BAND(cs)  + order[g * b] / b]);
+        h = mix64(h ^ c[CANON_STACK(cs) + order[N + g * b] / b]);
+    }
+    for (int v = 0; v <= N; v++) vals += mix64(c[CANON_VAL(cs) + v]);
+    return mix64(h ^ vals);
+}
+
+/*
+ * A complete order: the puzzle read in it with values numbered by first
+ * appearance.  Becomes the best if it is smaller, or if the invariants on
+ * its path were (fresh).
+ */
+static void canon_leaf(CanonSearch *cs, int depth, const int *order, bool fresh) {
+    int    N = cs->N, next = 1, sign = fresh ? -1 : 0;
+    Canon *best = cs->best;
+    memset(cs->lab, 0, (size_t)N + 1);
+    cs->work += (long)N * N;
+    for (int k = 0; k < N; k++)
+        for (int j = 0; j < N; j++) {
+            int r = order[k], col = order[N + j], x = 0;
+            int v = cs->t ? cs->grid[col * N + r] : cs->grid[r * N + col];
+            if (v) {
+                if (!cs->lab[v]) cs->lab[v] = (unsigned char)next++;
+                x = cs->lab[v];
+            }
+            cs->vals[k * N + j] = (unsigned char)x;
+            if (sign == 0 && x != best->givens[k * N + j]) {
+                if (x > best->givens[k * N + j]) return;
+                sign = -1;
+            }
+        }
+    if (sign == 0) {              /* the best again: an automorphism */
+        if (best->transposed != cs->t || cs->num_autos == CANON_AUTOS) return;
+        int *a = cs->autos + (size_t)cs->num_autos++ * cs->span;
+        for (int i = 0; i < cs->span; i++) a[i] = i;
+        for (int k = 0; k < N; k++) {
+            a[CANON_ROW(cs) + order[k]]     = CANON_ROW(cs) + best->row[k];
+            a[CANON_COL(cs) + order[N + k]] = CANON_COL(cs) + best->col[k];
+        }
+        for (int g = 0; g < cs->box; g++) {
+            int k = g * cs->box;
+            a[CANON_BAND(cs)  + order[k] / cs->box]     = CANON_BAND(cs)  + best->row[k] / cs->box;
+            a[CANON_STACK(cs) + order[N + k] / cs->box] = CANON_STACK(cs) + best->col[k] / cs->box;
+        }
+        return;
+    }
+
+    best->transposed = cs->t;
+    memcpy(best->row,    order,     (size_t)N * sizeof(int));
+    memcpy(best->col,    order + N, (size_t)N * sizeof(int));
+    memcpy(best->label,  cs->lab,   (size_t)N + 1);
+    memcpy(best->givens, cs->vals,  (size_t)N * N);
+    memcpy(cs->best_inv, cs->inv,   (size_t)(depth + 1) * sizeof(uint64_t));
+    cs->best_depth = depth + 1;
+    cs->version++;
+}
+
+/*
+ * Whether members[i] can be skipped: an automorphism found so far that
+ * fixes everything individualised above depth joins it with an earlier
+ * member, whose subtree then held the same leaves (the orbits of the
+ * group those automorphisms generate, by union-find).
+ */
+static bool canon_orbit(CanonSearch *cs, int depth, const int *members, int i) {
+    int *root = cs->orbit;
+    for (int j = 0; j <= i; j++) root[j] = j;
+    for (int a = 0; a < cs->num_autos; a++) {
+        const int *g = cs->autos + (size_t)a * cs->span;
+        bool fixes = true;
+        for (int d = 0; d < depth && fixes; d++)
+            fixes = g[cs->chosen[d]] == cs->chosen[d];
+        if (!fixes) continue;
+        for (int j = 0; j <= i; j++)
+            for (int k = 0; k <= i; k++) {
+                if (g[members[j]] != members[k]) continue;
+                int x = j, y = k;
+                while (root[x] != x) x = root[x];
+                while (root[y] != y) y = root[y];
+                if (x < y) root[y] = x; else root[x] = y;
+            }
+    }
+    int x = i;
+    while (root[x] != x) x = root[x];
+    return x < i;
+}
+
+/*
+ * Refines level depth and branches on each member of its first open
+ * class.  tight: the invariants so far are the best path's, so a greater
+ * one here ends the branch.
+ */
+static void canon_search(CanonSearch *cs, int depth, bool tight) {
+    int       N = cs->N;
+    uint64_t *c = cs->color + (size_t)depth * cs->span;
+    int      *order   = cs->order   + (size_t)depth * 2 * N;
+    int      *members = cs->members + (size_t)depth * N;
+    canon_refine(cs, c);
+    canon_order(cs, c, false, order);
+    canon_order(cs, c, true,  order + N);
+    int      n   = canon_target(cs, c, order, members);
+    uint64_t inv = canon_invariant(cs, c, order, n == 0);
+    if (tight) {
+        if (inv > cs->best_inv[depth]) return;
+        tight = inv == cs->best_inv[depth];
+    }
+    cs->inv[depth] = inv;
+    if (n == 0) { canon_leaf(cs, depth, order, !tight); return; }
+
+    uint64_t *child = c + cs->span;
+    for (int i = 0; i < n && cs->work <= CANON_WORK; i++) {
+        if (canon_orbit(cs, depth, members, i)) continue;
+        memcpy(child, c, (size_t)cs->span * sizeof(uint64_t));
+        child[members[i]] = mix64(child[members[i]] ^ 0x5bd1e995u);
+        cs->chosen[depth] = members[i];
+        long v = cs->version;
+        canon_search(cs, depth + 1, tight);
+        if (cs->version != v) tight = true;  /* the new best shares this path */
+    }
+}
+
+/* clues in range and no two equal in a row, column or box */
+static bool clues_consistent(const int *grid, int N, int box) {
+    uint64_t used[3 * CANON_MAX];
+    memset(used, 0, sizeof used);
+    for (int r = 0; r < N; r++)
+        for (int c = 0; c < N; c++) {
+            int v = grid[r * N + c];
+            if (v == 0) continue;
+            if (v < 0 || v > N) return false;
+            uint64_t bit = 1ull << (v - 1);
+            int u[3] = { r, N + c, 2 * N + r / box * box + c / box };
+            for (int i = 0; i < 3; i++) {
+                if (used[u[i]] & bit) return false;
+                used[u[i]] |= bit;
+            }
+        }
+    return true;
+}
+
+/*
+ * Fills *cf with the canonical form of the givens and the move onto it.
+ * False (and *cf empty) if the puzzle is too large, its clues clash, or
+ * the search runs out of CANON_WORK.
+ */
+static bool canonicalize(const int *grid, int N, int box, Canon *cf) {
+    memset(cf, 0, sizeof *cf);
+    if (N > CANON_MAX || !clues_consistent(grid, N, box)) return false;
+
+    /* each level makes at least one more row, column, band or stack unique */
+    size_t n = (size_t)N, levels = 2 * n + 2 * (size_t)box + 1;
+    cf->N      = N;
+    cf->box    = box;
+    cf->row    = malloc(n * sizeof(int));
+    cf->col    = malloc(n * sizeof(int));
+    cf->label  = malloc(n + 1);
+    cf->givens = malloc(n * n);
+
+    CanonSearch cs;
+    memset(&cs, 0, sizeof cs);
+    cs.grid     = grid;
+    cs.N        = N;
+    cs.box      = box;
+    cs.best     = cf;
+    cs.span     = 3 * N + 1 + 2 * box;
+    cs.clue     = malloc(3 * n * n * sizeof(int));
+    cs.empty    = malloc(2 * n * sizeof(bool));
+    cs.color    = malloc(levels * (size_t)cs.span * sizeof(uint64_t));
+    cs.next     = malloc((size_t)cs.span * sizeof(uint64_t));
+    cs.sorted   = malloc((n + 1) * sizeof(uint64_t));
+    cs.order    = malloc(levels * 2 * n * sizeof(int));
+    cs.members  = malloc(levels * n * sizeof(int));
+    cs.chosen   = malloc(levels * sizeof(int));
+    cs.autos    = malloc(CANON_AUTOS * (size_t)cs.span * sizeof(int));
+    cs.orbit    = malloc(n * sizeof(int));
+    cs.inv      = malloc(levels * sizeof(uint64_t));
+    cs.best_inv = malloc(levels * sizeof(uint64_t));
+    cs.vals     = malloc(n * n);
+    cs.lab      = malloc(n + 1);
+    if (!cf->row || !cf->col || !cf->label || !cf->givens || !cs.clue ||
+        !cs.empty || !cs.color || !cs.next || !cs.sorted || !cs.order ||
+        !cs.members || !cs.chosen || !cs.autos || !cs.orbit || !cs.inv ||
+        !cs.best_inv || !cs.vals || !cs.lab) {
+        fprintf(stderr, "OOM: canonical form\n"); exit(1);
+    }
+
+    for (int t = 0; t < 2; t++) {
+        cs.t         = t;
+        cs.num_clues = 0;
+        for (int i = 0; i < 2 * N; i++) cs.empty[i] = true;
+        for (int r = 0; r < N; r++)
+            for (int c = 0; c < N; c++) {
+                int v = t ? grid[c * N + r] : grid[r * N + c];
+                if (!v) continue;
+                int *e = cs.clue + 3 * cs.num_clues++;
+                e[0] = r; e[1] = c; e[2] = v;
+                cs.empty[r] = cs.empty[N + c] = false;
+            }
+        memset(cs.color, 0, (size_t)cs.span * sizeof(uint64_t));
+        canon_search(&cs, 0, cs.version > 0);
+    }
+    bool ok = cs.work <= CANON_WORK && cs.version > 0;
+
+    if (ok) {                        /* values without a clue, in order */
+        int next = 1;
+        for (int v = 1; v <= N; v++) if (cf->label[v]) next++;
+        for (int v = 1; v <= N; v++)
+            if (!cf->label[v]) cf->label[v] = (unsigned char)next++;
+        cf->label[0] = 0;
+    } else {
+        canon_free(cf);
+    }
+    free(cs.clue);    free(cs.empty);   free(cs.color);   free(cs.next);
+    free(cs.sorted);  free(cs.order);   free(cs.members); free(cs.inv);
+    free(cs.best_inv); free(cs.vals);   free(cs.lab);     free(cs.chosen);
+    free(cs.autos);   free(cs.orbit);
+    return ok;
+}
+
+/* a grid of the source puzzle in canonical coordinates and values */
+static void canon_apply(const Canon *cf, const int *grid, unsigned char *out) {
+    int N = cf->N;
+    for (int k = 0; k < N; k++)
+        for (int j = 0; j < N; j++) {
+            int r = cf->row[k], c = cf->col[j];
+            out[k * N + j] = cf->label[cf->transposed ? grid[c * N + r]
+                                                      : grid[r * N + c]];
+        }
+}
+
+/* ... and back */
+static void canon_invert(const Canon *cf, const unsigned char *in, int *grid) {
+    int           N = cf->N;
+    unsigned char value[CANON_MAX + 1];
+    for (int v = 0; v <= N; v++) value[cf->label[v]] = (unsigned char)v;
+    for (int k = 0; k < N; k++)
+        for (int j = 0; j < N; j++) {
+            int r = cf->row[k], c = cf->col[j];
+            grid[cf->transposed ? c * N + r : r * N + c] = value[in[k * N + j]];
+        }
+}
+
+/* ─── the cache: a hash table of canonical forms, and its file ───────────── */
+/*                                                                            */
+/*  The file is a PcacheHeader and then one record per entry: int32 N,     */
+/*  int32 answer (SAT or UNSAT), the N*N canonical clues, and after a SAT   */
+/*  the N*N solution in the same coordinates, one byte per cell.  A record  */
+/*  cut short by a crash is dropped when the file is opened again.          */
+
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint32_t bom;             /* CNFB_BOM */
+} PcacheHeader;
+
+typedef struct {
+    uint64_t       hash;
+    int            N;         /* 0: the slot is free */
+    int            res;       /* SAT or UNSAT */
+    unsigned char *cells;     /* N*N canonical clues, then the solution */
+} CacheEntry;
+
+typedef struct {
+    CacheEntry     *slots;    /* open addressing, cap is a power of two */
+    int             cap, count;
+    FILE           *file;     /* where new entries are appended, or NULL */
+    pthread_mutex_t lock;
+} PuzzleCache;
+
+static uint64_t pcache_hash(int N, const unsigned char *givens) {
+    uint64_t h = 14695981039346656037ull ^ (uint64_t)N;     /* FNV-1a */
+    for (int i = 0; i < N * N; i++) h = (h ^ givens[i]) * 1099511628211ull;
+    return h;
+}
+
+/* the entry for these clues, or the free slot where it would go */
+static CacheEntry *pcache_slot(PuzzleCache *pc, uint64_t h, int N,
+                               const unsigned char *givens) {
+    for (int i = (int)(h & (uint64_t)(pc->cap - 1));; i = (i + 1) & (pc->cap - 1)) {
+        CacheEntry *e = &pc->slots[i];
+        if (e->N == 0) return e;
+        if (e->hash == h && e->N == N &&
+            memcmp(e->cells, givens, (size_t)N * N) == 0)
+            return e;
+    }
+}
+
+/* takes an entry not in the table yet; cells is N*N clues (+ solution) */
+static void pcache_insert(PuzzleCache *pc, int N, int res, unsigned char *cells) {
+    if (2 * (pc->count + 1) > pc->cap) {
+        CacheEntry *old = pc->slots;
+        int         cap = pc->cap;
+        pc->cap   = cap ? 2 * cap : 1024;
+        pc->slots = calloc((size_t)pc->cap, sizeof(CacheEntry));
+        if (!pc->slots) { fprintf(stderr, "OOM: puzzle cache\n"); exit(1); }
+        for (int i = 0; i < cap; i++)
+            if (old[i].N) *pcache_slot(pc, old[i].hash, old[i].N, old[i].cells) = old[i];
+        free(old);
+    }
+    uint64_t    h = pcache_hash(N, cells);
+    CacheEntry *e = pcache_slot(pc, h, N, cells);
+    *e = (CacheEntry){ h, N, res, cells };
+    pc->count++;
+}
+
+/* reads the file's records; false if it is not a puzzle cache */
+static bool pcache_read(PuzzleCache *pc, const char *path) {
+    size_t len;
+    bool   mapped;
+    char  *buf = load_file(path, &len, &mapped);
+    if (!buf) return true;                       /* starts a new file */
+
+    PcacheHeader h;
+    bool   ok   = len == 0;
+    size_t good = 0;
+    if (len >= sizeof h) {
+        memcpy(&h, buf, sizeof h);
+        ok   = memcmp(h.magic, PCACHE_MAGIC, 4) == 0 &&
+               h.version == PCACHE_VERSION && h.bom == CNFB_BOM;
+        good = sizeof h;
+    }
+    while (ok && len - good >= 2 * sizeof(int32_t)) {
+        int32_t rec[2];
+        memcpy(rec, buf + good, sizeof rec);
+        if (rec[0] < 1 || rec[0] > CANON_MAX ||
+            (rec[1] != SAT && rec[1] != UNSAT)) {
+            ok = false;
+            break;
+        }
+        size_t cells = (size_t)rec[0] * (size_t)rec[0],
+               body  = rec[1] == SAT ? 2 * cells : cells;
+        if (len - good - sizeof rec < body) break;
+        const unsigned char *p = (const unsigned char *)buf + good + sizeof rec;
+        if (pcache_slot(pc, pcache_hash(rec[0], p), rec[0], p)->N == 0) {
+            unsigned char *copy = malloc(body);
+            if (!copy) { fprintf(stderr, "OOM: puzzle cache\n"); exit(1); }
+            memcpy(copy, p, body);
+            pcache_insert(pc, rec[0], rec[1], copy);
+        }
+        good += sizeof rec + body;
+    }
+    if (mapped) munmap(buf, len);
+    else        free(buf);
+    if (ok && good < len && truncate(path, (off_t)good) != 0) ok = false;
+    return ok;
+}
+
+static void pcache_free(PuzzleCache *pc) {
+    if (!pc) return;
+    for (int i = 0; i < pc->cap; i++) free(pc->slots[i].cells);
+    free(pc->slots);
+    if (pc->file) fclose(pc->file);
+    pthread_mutex_destroy(&pc->lock);
+    free(pc);
+}
+
+/* in memory only without a path; NULL if the file cannot be used */
+static PuzzleCache *pcache_new(const char *path) {
+    PuzzleCache *pc = calloc(1, sizeof *pc);
+    if (!pc) { fprintf(stderr, "OOM: puzzle cache\n"); exit(1); }
+    pthread_mutex_init(&pc->lock, NULL);
+    pc->cap   = 1024;
+    pc->slots = calloc((size_t)pc->cap, sizeof(CacheEntry));
+    if (!pc->slots) { fprintf(stderr, "OOM: puzzle cache\n"); exit(1); }
+    if (!path) return pc;
+
+    if (!pcache_read(pc, path)) {
+        fprintf(stderr, "Not a puzzle cache: %s\n", path);
+        pcache_free(pc);
+        return NULL;
+    }
+    pc->file = fopen(path, "ab");
+    bool ok = pc->file != NULL && fseek(pc->file, 0, SEEK_END) == 0;
+    if (ok && ftell(pc->file) == 0) {
+        PcacheHeader h;
+        memcpy(h.magic, PCACHE_MAGIC, 4);
+        h.version = PCACHE_VERSION;
+        h.bom     = CNFB_BOM;
+        ok = fwrite(&h, sizeof h, 1, pc->file) == 1 && fflush(pc->file) == 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "Cannot open puzzle cache: %s\n", path);
+        pcache_free(pc);
+        return NULL;
+    }
+    return pc;
+}
+
+/* ─── what the front ends call ───────────────────────────────────────────── */
+
+/* a puzzle as the cache sees it */
+typedef struct {
+    Canon cf;
+    bool  keyed;       /* cf is its canonical form */
+} PuzzleKey;
+
+/*
+ * Looks a puzzle file's text up.  SAT with the solution in *solution
+ * (caller frees), UNSAT, or UNASSIGNED if it is not cached, in which
+ * case *key says what pcache_record() should store.
+ */
+static int pcache_query(PuzzleCache *pc, const char *buf, size_t len,
+                        PuzzleKey *key, int **solution) {
+    key->keyed = false;
+    *solution  = NULL;
+    if (!pc || !is_puzzle(buf, len)) return UNASSIGNED;
+    int  N, box;
+    int *grid = parse_puzzle(buf, len, &N, &box);
+    if (!grid) return UNASSIGNED;
+    key->keyed = canonicalize(grid, N, box, &key->cf);
+    free(grid);
+    if (!key->keyed) return UNASSIGNED;
+
+    pthread_mutex_lock(&pc->lock);
+    const CacheEntry *e = pcache_slot(pc, pcache_hash(N, key->cf.givens), N,
+                                      key->cf.givens);
+    int res = e->N ? e->res : UNASSIGNED;
+    if (res == SAT) {
+        *solution = malloc((size_t)N * (size_t)N * sizeof(int));
+        if (!*solution) { fprintf(stderr, "OOM: puzzle cache\n"); exit(1); }
+        canon_invert(&key->cf, e->cells + (size_t)N * N, *solution);
+    }
+    pthread_mutex_unlock(&pc->lock);
+    return res;
+}
+
+/* the same for a file on disk */
+static int pcache_query_file(PuzzleCache *pc, const char *path,
+                             PuzzleKey *key, int **solution) {
+    key->keyed = false;
+    *solution  = NULL;
+    if (!pc) return UNASSIGNED;
+    size_t len;
+    bool   mapped;
+    char  *buf = load_file(path, &len, &mapped);
+    if (!buf) return UNASSIGNED;
+    int res = pcache_query(pc, buf, len, key, solution);
+    if (mapped) munmap(buf, len);
+    else        free(buf);
+    return res;
+}
+
+/*
+ * Stores the answer the solver found for a keyed puzzle that missed;
+ * after a SAT the model must be complete (extend_model() done).  A grid
+ * that leaves a cell open or disagrees with a clue is not stored.
+ */
+static void pcache_record(PuzzleCache *pc, PuzzleKey *key, Solver *s, int res) {
+    if (!pc || !key->keyed || (res != SAT && res != UNSAT)) return;
+    int    N     = key->cf.N;
+    size_t cells = (size_t)N * (size_t)N;
+    unsigned char *rec = malloc(res == SAT ? 2 * cells : cells);
+    if (!rec) { fprintf(stderr, "OOM: puzzle cache\n"); exit(1); }
+    memcpy(rec, key->cf.givens, cells);
+    if (res == SAT) {
+        if (s->N != N) { free(rec); return; }
+        int *grid = decode_grid(s);
+        bool ok   = true;
+        for (size_t i = 0; i < cells && ok; i++) ok = grid[i] >= 1 && grid[i] <= N;
+        if (ok) canon_apply(&key->cf, grid, rec + cells);
+        for (size_t i = 0; i < cells && ok; i++)
+            ok = !rec[i] || rec[i] == rec[cells + i];
+        free(grid);
+        if (!ok) { free(rec); return; }
+    }
+
+    pthread_mutex_lock(&pc->lock);
+    if (pcache_slot(pc, pcache_hash(N, rec), N, rec)->N == 0) {
+        pcache_insert(pc, N, res, rec);
+        if (pc->file) {
+            int32_t head[2] = { N, res };
+            size_t  body    = res == SAT ? 2 * cells : cells;
+            if (fwrite(head, sizeof head, 1, pc->file) != 1 ||
+                fwrite(rec, 1, body, pc->file) != body ||
+                fflush(pc->file) != 0) {
+                fprintf(stderr, "Could not write puzzle cache\n");
+                fclose(pc->file);
+                pc->file = NULL;
+            }
+        }
+    } else {
+        free(rec);
+    }
+    pthread_mutex_unlock(&pc->lock);
+}
+
+/* the model of a loaded puzzle's encoding that puts grid in its cells */
+static void grid_model(Solver *s, const int *grid) {
+    for (int v = 1; v <= s->num_vars && v < s->var_info_cap; v++) {
+        const VarEntry *e = &s->var_info[v];
+        set_var_value(s, v, grid[(e->r - 1) * s->N + e->c - 1] == e->v);
+    }
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Batch mode (--batch): many instances, one process, a work-stealing pool    */
+/*                                                                            */
+/*  Jobs are sorted largest file first and dealt round-robin onto one queue  */
+/*  per worker.  A worker takes from the front of its own queue; when that   */
+/*  runs dry it steals from the back of another, so the small boards left    */
+/*  over never wait behind somebody's 36x36.  Every job gets its own Solver, */
+/*  and a result line is printed as soon as the job finishes.  A puzzle     */
+/*  file the result cache knows is answered without one.                     */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    char     *path;
+    long long size;      /* file size in bytes, the cost estimate */
+} BatchJob;
+
+typedef struct {
+    int            *jobs;    /* indices into Batch.jobs, live in [head, tail) */
+    int             head, tail;
+    pthread_mutex_t lock;
+} JobQueue;
+
+typedef struct {
+    BatchJob       *jobs;
+    int             num_jobs, jobs_cap;
+    JobQueue       *queues;
+    int             num_workers;
+    int             restart_policy;
+    int             cache_flags;
+    bool            preprocess;
+    bool            simplify;
+    bool            fast_path;   /* board_solve() before the search */
+    Budget          budget;      /* per instance */
+    PuzzleCache    *cache;       /* asked before loading, or NULL */
+    pthread_mutex_t out_lock;    /* result lines and the counters below */
+    int             num_sat, num_unsat, num_unknown, num_failed, num_cached;
+} Batch;
+
+typedef struct {
+    Batch *batch;
+    int    id;
+} BatchWorker;
+
+static bool has_suffix(const char *str, const char *suffix) {
+    size_t n = strlen(str), k = strlen(suffix);
+    return n >= k && strcmp(str + n - k, suffix) == 0;
+}
+
+static void batch_push(Batch *b, const char *path) {
+    if (b->num_jobs >= b->jobs_cap) {
+        b->jobs_cap = b->jobs_cap ? b->jobs_cap * 2 : 64;
+        b->jobs = realloc(b->jobs, (size_t)b->jobs_cap * sizeof(BatchJob));
+        if (!b->jobs) { fprintf(stderr, "OOM: batch jobs\n"); exit(1); }
+    }
+    struct stat st;
+    BatchJob *j = &b->jobs[b->num_jobs++];
+    j->path = malloc(strlen(path) + 1);
+    if (!j->path) { fprintf(stderr, "OOM: batch jobs\n"); exit(1); }
+    strcpy(j->path, path);
+    j->size = stat(path, &st) == 0 ? (long long)st.st_size : 0;
+}
+
+/*
+ * A directory contributes its *.cnf and *.cnfb files, except X.cnfb when
+ * X.cnf is there too (that is X's parse cache, read anyway); any other
+ * file is a manifest with one path per line, '#' starting a comment.
+ */
+static bool batch_collect(Batch *b, const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "Cannot open batch: %s\n", path);
+        return false;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        DIR *d = opendir(path);
+        if (!d) { fprintf(stderr, "Cannot open batch: %s\n", path); return false; }
+        size_t plen = strlen(path);
+        struct dirent *e;
+        while ((e = readdir(d)) != NULL) {
+            bool cnf = has_suffix(e->d_name, ".cnf") ||
+                       has_suffix(e->d_name, ".txt");
+            if (!cnf && !has_suffix(e->d_name, ".cnfb")) continue;
+            char *full = malloc(plen + strlen(e->d_name) + 2);
+            if (!full) { fprintf(stderr, "OOM: batch jobs\n"); exit(1); }
+            sprintf(full, "%s/%s", path, e->d_name);
+            if (!cnf) {
+                full[strlen(full) - 1] = '\0';        /* X.cnfb -> X.cnf */
+                bool cached = stat(full, &st) == 0;
+                strcat(full, "b");
+                if (cached) { free(full); continue; }
+            }
+            batch_push(b, full);
+            free(full);
+        }
+        closedir(d);
+        return true;
+    }
+
+    FILE *f = fopen(path, "r");
+    if (!f) { fprintf(stderr, "Cannot open batch: %s\n", path); return false; }
+    char  *line = NULL;
+    size_t cap  = 0;
+    while (getline(&line, &cap, f) > 0) {
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        char *p = line, *q;
+        while (*p == ' ' || *p == '\t') p++;
+        for (q = p + strlen(p); q > p && (q[-1] == '\n' || q[-1] == '\r' ||
+                                          q[-1] == ' '  || q[-1] == '\t'); q--)
+            ;
+        *q = '\0';
+        if (*p) batch_push(b, p);
+    }
+    free(line);
+    fclose(f);
+    return true;
+}
+
+/* largest first; equal sizes by path so the deal is reproducible */
+static int job_cmp(const void *a, const void *b) {
+    const BatchJob *x = a, *y = b;
+    if (x->size != y->size) return x->size > y->size ? -1 : 1;
+    return strcmp(x->path, y->path);
+}
+
+static bool job_take(Batch *b, int id, int *job) {
+    JobQueue *own = &b->queues[id];
+    pthread_mutex_lock(&own->lock);
+    bool got = own->head < own->tail;
+    if (got) *job = own->jobs[own->head++];
+    pthread_mutex_unlock(&own->lock);
+    if (got) return true;
+
+    for (int k = 1; k < b->num_workers; k++) {
+        JobQueue *q = &b->queues[(id + k) % b->num_workers];
+        pthread_mutex_lock(&q->lock);
+        got = q->head < q->tail;
+        if (got) *job = q->jobs[--q->tail];
+        pthread_mutex_unlock(&q->lock);
+        if (got) return true;
+    }
+    return false;      /* nothing is ever queued again, so this is final */
+}
+
+static void *batch_worker(void *arg) {
+    BatchWorker *w = arg;
+    Batch       *b = w->batch;
+    int          j;
+    while (job_take(b, w->id, &j)) {
+        double    t0 = now_ms();
+        PuzzleKey key;
+        int      *solution;
+        int       res    = pcache_query_file(b->cache, b->jobs[j].path, &key,
+                                             &solution);
+        bool      cached = res != UNASSIGNED;
+        const char *limit = NULL;
+        if (!cached) {
+            Solver *s = solver_new();
+            s->restart_policy = b->restart_policy;
+            s->preprocess     = b->preprocess;
+            s->budget         = b->budget;
+            if (load_instance(s, b->jobs[j].path, b->cache_flags)) {
+                if (b->fast_path) res = board_solve(s);
+                if (res == UNASSIGNED) {
+                    if (b->simplify) simplify(s);
+                    res = solve(s);
+                }
+                if (res == SAT && key.keyed) extend_model(s);
+                pcache_record(b->cache, &key, s, res);
+            }
+            limit = s->limit_hit;             /* a string literal */
+            solver_free(s);
+        }
+        if (key.keyed) canon_free(&key.cf);
+        free(solution);
+        double ms = now_ms() - t0;
+
+        pthread_mutex_lock(&b->out_lock);
+        if      (res == SAT)     b->num_sat++;
+        else if (res == UNSAT)   b->num_unsat++;
+        else if (res == UNKNOWN) b->num_unknown++;
+        else                     b->num_failed++;
+        if (cached) b->num_cached++;
+        printf("%-7s %10.1f ms  %s", res == SAT ? "SAT" : res == UNSAT ? "UNSAT" :
+               res == UNKNOWN ? "UNKNOWN" : "ERROR", ms, b->jobs[j].path);
+        if (limit)  printf("  (%s limit)", limit);
+        if (cached) printf("  (cached)");
+        putchar('\n');
+        fflush(stdout);
+        pthread_mutex_unlock(&b->out_lock);
+    }
+    return NULL;
+}
+
+static int run_batch(const char *path, int jobs, int restart_policy,
+                     int cache_flags, bool preprocess, bool simp,
+                     bool fast_path, Budget budget, PuzzleCache *cache) {
+    Batch b;
+    memset(&b, 0, sizeof b);
+    b.restart_policy = restart_policy;
+    b.cache_flags    = cache_flags;
+    b.preprocess     = preprocess;
+    b.simplify       = simp;
+    b.fast_path      = fast_path;
+    b.budget         = budget;
+    b.cache          = cache;
+    if (!batch_collect(&b, path)) return 1;
+    qsort(b.jobs, (size_t)b.num_jobs, sizeof(BatchJob), job_cmp);
+
+    if (jobs <= 0) jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs > b.num_jobs) jobs = b.num_jobs;
+    if (jobs < 1) jobs = 1;
+    b.num_workers = jobs;
+
+    b.queues = calloc((size_t)jobs, sizeof(JobQueue));
+    BatchWorker *workers = calloc((size_t)jobs, sizeof(BatchWorker));
+    pthread_t   *threads = calloc((size_t)jobs, sizeof(pthread_t));
+    if (!b.queues || !workers || !threads) {
+        fprintf(stderr, "OOM: batch workers\n"); exit(1);
+    }
+    for (int w = 0; w < jobs; w++) {
+        JobQueue *q = &b.queues[w];
+        q->jobs = malloc(((size_t)b.num_jobs / (size_t)jobs + 1) * sizeof(int));
+        if (!q->jobs) { fprintf(stderr, "OOM: batch queues\n"); exit(1); }
+        pthread_mutex_init(&q->lock, NULL);
+    }
+    for (int j = 0; j < b.num_jobs; j++) {
+        JobQueue *q = &b.queues[j % jobs];
+        q->jobs[q->tail++] = j;
+    }
+    pthread_mutex_init(&b.out_lock, NULL);
+
+    double t0 = now_ms();
+    for (int w = 0; w < jobs; w++) {
+        workers[w] = (BatchWorker){&b, w};
+        if (pthread_create(&threads[w], NULL, batch_worker, &workers[w]) != 0) {
+            fprintf(stderr, "Cannot start batch worker\n"); exit(1);
+        }
+    }
+    for (int w = 0; w < jobs; w++) pthread_join(threads[w], NULL);
+
+    printf("c batch: %d instances, %d SAT, %d UNSAT, %d UNKNOWN, %d failed, "
+           "%d cached, %d threads, %.1f ms\n", b.num_jobs, b.num_sat,
+           b.num_unsat, b.num_unknown, b.num_failed, b.num_cached, jobs,
+           now_ms() - t0);
+
+    for (int w = 0; w < jobs; w++) {
+        pthread_mutex_destroy(&b.queues[w].lock);
+        free(b.queues[w].jobs);
+    }
+    for (int j = 0; j < b.num_jobs; j++) free(b.jobs[j].path);
+    pthread_mutex_destroy(&b.out_lock);
+    free(b.jobs);
+    free(b.queues);
+    free(workers);
+    free(threads);
+    return b.num_failed ? 1 : 0;
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Portfolio mode (--portfolio=K)                                             */
+/*                                                                            */
+/*  The instance is parsed once and K differently configured copies race on */
+/*  it; the first definite answer wins and the others are stopped through   */
+/*  the terminate hook at their next conflict.  Worker 0 runs exactly the    */
+/*  single-threaded configuration, the rest vary restart policy, initial     */
+/*  polarity and a seeded jitter of the initial VSIDS order.                 */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+#define PHASE_POSITIVE  0
+#define PHASE_NEGATIVE  1
+#define PHASE_RANDOM    2
+
+typedef struct {
+    atomic_int  winner;      /* worker index of the first answer, or -1 */
+    int         answer;
+} Race;
+
+typedef struct {
+    Race   *race;
+    Solver *solver;
+    int     id;
+    int     phase;
+    int     result;
+} PortfolioWorker;
+
+static int race_over(void *data) {
+    return atomic_load_explicit(&((Race *)data)->winner,
+                                memory_order_relaxed) >= 0;
+}
+
+static uint64_t xorshift64(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    return *state = x;
+}
+
+static void portfolio_configure(PortfolioWorker *w, int base_policy) {
+    Solver *s  = w->solver;
+    int     id = w->id;
+    if (id == 0) { w->phase = PHASE_POSITIVE; return; }
+
+    /* odd workers flip between the two restart policies that restart */
+    if (id % 2)
+        s->restart_policy = base_policy == RESTART_GLUCOSE ? RESTART_LUBY
+                                                           : RESTART_GLUCOSE;
+    w->phase = (id / 2) % 3;
+
+    uint64_t rng = 0x9E3779B97F4A7C15ull * (uint64_t)id;
+    for (int v = 1; v <= s->num_vars; v++) {
+        s->activity[v] = (double)(xorshift64(&rng) >> 11) * 0x1p-53 * 1e-3;
+        if      (w->phase == PHASE_NEGATIVE) s->phase[v] = 0;
+        else if (w->phase == PHASE_RANDOM)   s->phase[v] = (char)(xorshift64(&rng) & 1);
+    }
+
+    /* the jitter broke the heap order: rebuild it */
+    s->heap_size = 0;
+    for (int v = 1; v <= s->num_vars; v++) s->heap_pos[v] = -1;
+    for (int v = 1; v <= s->num_vars; v++) heap_insert(s, v);
+}
+
+static void *portfolio_worker(void *arg) {
+    PortfolioWorker *w = arg;
+    w->result = solve(w->solver);
+    if (w->result != UNKNOWN) {
+        int none = -1;
+        if (atomic_compare_exchange_strong(&w->race->winner, &none, w->id))
+            w->race->answer = w->result;
+    }
+    return NULL;
+}
+
+static Share *share_new(int k) {
+    Share *sh = calloc(1, sizeof *sh);
+    if (!sh) { fprintf(stderr, "OOM: share\n"); exit(1); }
+    sh->num     = k;
+    sh->rings   = calloc((size_t)k, sizeof(ShareRing));
+    sh->cursors = calloc((size_t)k * (size_t)k, sizeof(long));
+    if (!sh->rings || !sh->cursors) { fprintf(stderr, "OOM: share\n"); exit(1); }
+    for (int w = 0; w < k; w++) {
+        sh->rings[w].ring = malloc(SHARE_RING * sizeof(atomic_int));
+        if (!sh->rings[w].ring) { fprintf(stderr, "OOM: share\n"); exit(1); }
+        for (int i = 0; i < SHARE_RING; i++) atomic_init(&sh->rings[w].ring[i], 0);
+        atomic_init(&sh->rings[w].head, 0);
+    }
+    return sh;
+}
+
+static void share_free(Share *sh) {
+    if (!sh) return;
+    for (int w = 0; w < sh->num; w++) free(sh->rings[w].ring);
+    free(sh->rings);
+    free(sh->cursors);
+    free(sh);
+}
+
+/* solves base with k racing copies; base receives the winning model */
+static int run_portfolio(Solver *base, int k, bool share) {
+    static const char *policy_names[] = {"none", "luby", "glucose"};
+    static const char *phase_names[]  = {"positive", "negative", "random"};
+
+    Race race;
+    atomic_init(&race.winner, -1);
+    race.answer = UNKNOWN;
+
+    PortfolioWorker *workers = calloc((size_t)k, sizeof(PortfolioWorker));
+    pthread_t       *threads = calloc((size_t)k, sizeof(pthread_t));
+    if (!workers || !threads) { fprintf(stderr, "OOM: portfolio\n"); exit(1); }
+    Share *sh = share ? share_new(k) : NULL;
+
+    for (int i = 0; i < k; i++) {
+        PortfolioWorker *w = &workers[i];
+        w->race   = &race;
+        w->id     = i;
+        w->solver = solver_clone(base);
+        w->solver->terminate = race_over;
+        w->solver->term_data = &race;
+        w->solver->share     = sh;
+        w->solver->share_id  = i;
+        portfolio_configure(w, base->restart_policy);
+    }
+    for (int i = 0; i < k; i++)
+        if (pthread_create(&threads[i], NULL, portfolio_worker, &workers[i])) {
+            fprintf(stderr, "Cannot start portfolio worker\n"); exit(1);
+        }
+    for (int i = 0; i < k; i++) pthread_join(threads[i], NULL);
+
+    int won = atomic_load(&race.winner);
+    if (won >= 0) {
+        Solver *w = workers[won].solver;
+        long out = 0;
+        for (int i = 0; i < k; i++) out += workers[i].solver->shared_out;
+        fprintf(stderr, "c portfolio: worker %d of %d answered "
+                "(%s restarts, %s phase), %ld clauses shared, %ld imported\n",
+                won, k, policy_names[w->restart_policy],
+                phase_names[workers[won].phase], out, w->shared_in);
+        memcpy(base->value, w->value, 2 * ((size_t)base->num_vars + 1));
+    }
+    for (int i = 0; i < k; i++) stats_add(base, workers[i].solver);
+    for (int i = 0; i < k; i++) solver_free(workers[i].solver);
+    share_free(sh);
+    free(workers);
+    free(threads);
+    return race.answer;
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Cube and conquer (--cubes=D)                                               */
+/*                                                                            */
+/*  Lookahead splits the instance into up to 2^D cubes — conjunctions of     */
+/*  literals that together cover every solution.  At each node every        */
+/*  candidate variable is probed both ways and the one whose two branches    */
+/*  propagate most (product of the implied counts) is split on; a branch     */
+/*  that conflicts is refuted on the spot.  On Sudoku the candidates are the */
+/*  value variables of the cells with the fewest values left, otherwise the  */
+/*  variables that occur most.                                               */
+/*                                                                            */
+/*  The cubes are then solved under assumptions by --jobs threads, each       */
+/*  with its own copy of the instance that keeps its learned clauses from    */
+/*  cube to cube, or written as an iCNF file (--cube-out) for other hosts.   */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+#define CUBE_CANDIDATES  32      /* variables probed at each lookahead node */
+
+typedef struct {
+    int *lits;                   /* cubes back to back, each 0-terminated */
+    int  lits_len, lits_cap;
+    int *start;                  /* start[i] = offset of cube i in lits    */
+    int  num, start_cap;
+    int  refuted;                /* branches closed during lookahead       */
+} CubeSet;
+
+static int cmp_desc_key(const void *a, const void *b) {
+    const long long *x = a, *y = b;          /* (key << 32 | var) pairs */
+    return *x < *y ? 1 : *x > *y ? -1 : 0;
+}
+
+static int cube_candidates(Solver *s, int *cand) {
+    int        n    = s->num_vars;
+    long long *keys = calloc((size_t)n + 1, sizeof(long long));
+    if (!keys) { fprintf(stderr, "OOM: cube candidates\n"); exit(1); }
+
+    if (s->N > 0 && s->var_info_cap > 0) {
+        /* free values per cell; fewer is better */
+        int *free_vals = calloc((size_t)s->N * (size_t)s->N, sizeof(int));
+        if (!free_vals) { fprintf(stderr, "OOM: cube candidates\n"); exit(1); }
+        for (int v = 1; v <= n && v < s->var_info_cap; v++) {
+            VarEntry *e = &s->var_info[v];
+            if (e->r >= 1 && e->r <= s->N && e->c >= 1 && e->c <= s->N &&
+                var_value(s, v) == UNASSIGNED)
+                free_vals[(e->r - 1) * s->N + e->c - 1]++;
+        }
+        for (int v = 1; v <= n && v < s->var_info_cap; v++) {
+            VarEntry *e = &s->var_info[v];
+            if (e->r < 1 || e->r > s->N || e->c < 1 || e->c > s->N ||
+                var_value(s, v) != UNASSIGNED)
+                continue;
+            int f = free_vals[(e->r - 1) * s->N + e->c - 1];
+            keys[v] = f >= 2 ? (long long)(s->N * s->N + 1 - f) : 0;
+        }
+        free(free_vals);
+    } else {
+        for (int v = 1; v <= n; v++)
+            if (var_value(s, v) == UNASSIGNED)
+                keys[v] = (long long)s->watches[watch_index(v)].size +
+                          s->watches[watch_index(-v)].size +
+                          s->bins[watch_index(v)].size +
+                          s->bins[watch_index(-v)].size + 1;
+    }
+
+    int m = 0;
+    for (int v = 1; v <= n; v++)
+        if (keys[v] > 0 && !s->eliminated[v]) keys[m++] = keys[v] << 32 | v;
+    qsort(keys, (size_t)m, sizeof(long long), cmp_desc_key);
+    if (m > CUBE_CANDIDATES) m = CUBE_CANDIDATES;
+    for (int i = 0; i < m; i++) cand[i] = (int)(keys[i] & 0xffffffff);
+    free(keys);
+    return m;
+}
+
+/* s holds cube[0..len) as decisions, propagated without conflict */
+static void cube_split(Solver *s, CubeSet *out, const int *cand, int num_cand,
+                       int depth, int *cube, int len) {
+    int       best = 0;
+    long long best_score = -1;
+    for (int i = 0; depth > 0 && i < num_cand; i++) {
+        int v = cand[i];
+        if (var_value(s, v) != UNASSIGNED) continue;
+        int pos = probe(s, v), neg = probe(s, -v);
+        if (pos < 0 && neg < 0) { out->refuted++; return; }
+        long long score = (pos < 0 || neg < 0) ? LLONG_MAX
+                        : (long long)(pos + 1) * (neg + 1);
+        if (score > best_score) { best_score = score; best = v; }
+        if (score == LLONG_MAX) break;       /* forced: split costs nothing */
+    }
+
+    if (best == 0) {
+        out->start = realloc(out->start, (size_t)(out->num + 1) * sizeof(int));
+        if (!out->start) { fprintf(stderr, "OOM: cubes\n"); exit(1); }
+        out->start[out->num++] = out->lits_len;
+        for (int i = 0; i < len; i++)
+            push_int(&out->lits, &out->lits_len, &out->lits_cap, cube[i], "cubes");
+        push_int(&out->lits, &out->lits_len, &out->lits_cap, 0, "cubes");
+        return;
+    }
+
+    for (int sign = 1; sign >= -1; sign -= 2) {
+        int lit = sign * best;
+        new_level(s);
+        assign(s, lit, s->level, CREF_NONE);
+        if (propagate(s) == CREF_NONE) {
+            cube[len] = lit;
+            cube_split(s, out, cand, num_cand, depth - 1, cube, len + 1);
+        } else {
+            out->refuted++;
+        }
+        backtrack(s, s->level - 1);
+    }
+}
+
+static void make_cubes(Solver *base, int depth, CubeSet *out) {
+    memset(out, 0, sizeof *out);
+    Solver *s = solver_clone(base);     /* probing must not disturb base */
+    s->N            = base->N;
+    s->var_info     = base->var_info;
+    s->var_info_cap = base->var_info_cap;
+
+    if (s->ok && propagate(s) == CREF_NONE) {
+        int *cand = malloc(CUBE_CANDIDATES * sizeof(int));
+        int *cube = malloc(((size_t)depth + 1) * sizeof(int));
+        if (!cand || !cube) { fprintf(stderr, "OOM: cubes\n"); exit(1); }
+        int  num_cand = cube_candidates(s, cand);
+        cube_split(s, out, cand, num_cand, depth, cube, 0);
+        free(cand);
+        free(cube);
+    } else {
+        out->refuted++;
+    }
+    s->var_info = NULL;                 /* borrowed */
+    solver_free(s);
+}
+
+/* iCNF: the clauses, then one "a <lits> 0" line per cube */
+static bool write_icnf(Solver *s, const CubeSet *cubes, const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) return false;
+    fprintf(f, "p inccnf\n");
+    for (size_t cr = 0; cr < s->arena_size;
+         cr += (size_t)CLAUSE_WORDS(clause_at(s, (CRef)cr)->size)) {
+        Clause *c = clause_at(s, (CRef)cr);
+        if (c->deleted || c->learnt) continue;
+        for (int i = 0; i < c->size; i++) fprintf(f, "%d ", c->lits[i]);
+        fprintf(f, "0\n");
+    }
+    for (int w = 2; w < 2 * s->num_vars + 2; w++)
+        for (int k = 0; k < s->bins[w].size; k++)
+            if (w < watch_index(s->bins[w].lits[k]))
+                fprintf(f, "%d %d 0\n", index_lit(w), s->bins[w].lits[k]);
+    for (int g = 0; g < s->num_amo; g++)          /* pairwise, for other solvers */
+        for (int i = s->amo_start[g]; i < s->amo_start[g + 1]; i++)
+            for (int j = i + 1; j < s->amo_start[g + 1]; j++)
+                fprintf(f, "%d %d 0\n", -s->amo_lits[i], -s->amo_lits[j]);
+    for (int i = 0; i < cubes->num; i++) {
+        fprintf(f, "a ");
+        for (const int *l = cubes->lits + cubes->start[i]; *l; l++)
+            fprintf(f, "%d ", *l);
+        fprintf(f, "0\n");
+    }
+    return fclose(f) == 0;
+}
+
+typedef struct {
+    Race          *race;
+    const CubeSet *cubes;
+    atomic_int    *next;         /* next cube to hand out */
+    Solver        *solver;
+    int            id;
+    int            solved;       /* cubes this worker refuted or satisfied */
+    double         deadline;     /* of the whole run, 0 = none */
+} CubeWorker;
+
+static void *cube_worker(void *arg) {
+    CubeWorker *w = arg;
+    Solver     *s = w->solver;
+    for (;;) {
+        int i = atomic_fetch_add(w->next, 1);
+        if (i >= w->cubes->num || race_over(w->race)) break;
+        /* the other limits hold per cube, the clock for the whole run */
+        if (w->deadline > 0) {
+            s->budget.time_ms = w->deadline - now_ms();
+            if (s->budget.time_ms <= 0) { s->limit_hit = "time"; break; }
+        }
+        for (const int *l = w->cubes->lits + w->cubes->start[i]; *l; l++)
+            push_int(&s->assumps, &s->num_assumps, &s->assumps_cap, *l, "assumps");
+        int res = solve(s);
+        if (res == UNKNOWN) break;
+        w->solved++;
+        /* SAT ends the search; so does UNSAT that needed no assumption */
+        if (res == SAT || !s->ok) {
+            int none = -1;
+            if (atomic_compare_exchange_strong(&w->race->winner, &none, w->id))
+                w->race->answer = res;
+            break;
+        }
+    }
+    return NULL;
+}
+
+static int run_cubes(Solver *base, int depth, int jobs, const char *out_path) {
+    double  t0       = now_ms();
+    double  deadline = base->budget.time_ms > 0 ? t0 + base->budget.time_ms : 0;
+    CubeSet cubes;
+    make_cubes(base, depth, &cubes);
+    fprintf(stderr, "c cubes: %d cubes, %d branches refuted by lookahead, "
+            "%.1f ms\n", cubes.num, cubes.refuted, now_ms() - t0);
+
+    int res = UNSAT;
+    if (out_path) {
+        res = write_icnf(base, &cubes, out_path) ? UNKNOWN : UNASSIGNED;
+        if (res == UNKNOWN) fprintf(stderr, "c wrote %s\n", out_path);
+        else                fprintf(stderr, "Could not write %s\n", out_path);
+    } else if (cubes.num > 0) {
+        if (jobs <= 0) jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (jobs > cubes.num) jobs = cubes.num;
+        if (jobs < 1) jobs = 1;
+
+        Race race;
+        atomic_init(&race.winner, -1);
+        race.answer = UNKNOWN;
+        atomic_int next;
+        atomic_init(&next, 0);
+
+        CubeWorker *workers = calloc((size_t)jobs, sizeof(CubeWorker));
+        pthread_t  *threads = calloc((size_t)jobs, sizeof(pthread_t));
+        if (!workers || !threads) { fprintf(stderr, "OOM: cubes\n"); exit(1); }
+        for (int i = 0; i < jobs; i++) {
+            workers[i] = (CubeWorker){&race, &cubes, &next, solver_clone(base),
+                                      i, 0, deadline};
+            workers[i].solver->terminate = race_over;
+            workers[i].solver->term_data = &race;
+        }
+        for (int i = 0; i < jobs; i++)
+            if (pthread_create(&threads[i], NULL, cube_worker, &workers[i])) {
+                fprintf(stderr, "Cannot start cube worker\n"); exit(1);
+            }
+        for (int i = 0; i < jobs; i++) pthread_join(threads[i], NULL);
+
+        int won = atomic_load(&race.winner), solved = 0;
+        for (int i = 0; i < jobs; i++) solved += workers[i].solved;
+        if (won >= 0) {
+            res = race.answer;
+            if (res == SAT)
+                memcpy(base->value, workers[won].solver->value,
+                       2 * ((size_t)base->num_vars + 1));
+        } else if (solved < cubes.num) {
+            res = UNKNOWN;                   /* some cube ran out of budget */
+        }
+        fprintf(stderr, "c cubes: %d of %d solved by %d threads, %.1f ms\n",
+                solved, cubes.num, jobs, now_ms() - t0);
+        for (int i = 0; i < jobs; i++) stats_add(base, workers[i].solver);
+        for (int i = 0; i < jobs; i++) solver_free(workers[i].solver);
+        free(workers);
+        free(threads);
+    }
+    free(cubes.lits);
+    free(cubes.start);
+    return res;
+}
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* Server mode (--serve, --serve=SOCKET)                                      */
+/*                                                                            */
+/*  One long-running process answers a stream of instances, read from       */
+/*  standard input or from every connection to a Unix socket.  A request    */
+/*  is either                                                                */
+/*      @<bytes>\n<bytes of DIMACS, .cnfb or a puzzle file>                  */
+/*  or a single line of N² cells, '0' or '.' for a blank, 1-9 and then     */
+/*  A-Z for the values 10-35.  Blank lines are ignored.  Requests go to a   */
+/*  bounded queue served by --jobs threads, each keeping its own Solver    */
+/*  and resetting it between instances; puzzles the result cache knows     */
+/*  skip the Solver altogether.  The answer is one line, written            */
+/*  in completion order and tagged with the request's number on its stream: */
+/*      <id> SAT <grid in the same cell alphabet>   (numbers past N = 35)    */
+/*      <id> SAT <DIMACS model ending in 0>         (no Sudoku metadata)     */
+/*      <id> UNSAT | <id> UNKNOWN <limit> | <id> ERROR <reason>              */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+#define SERVE_MAX_REQUEST  (1L << 30)   /* refuse '@' payloads past 1 GiB */
+
+/* one input stream; requests in flight keep it alive to answer on it */
+typedef struct {
+    int             fd;        /* where the answers go */
+    bool            owns_fd;
+    pthread_mutex_t lock;      /* one answer line at a time */
+    int             refs;      /* the reader plus every queued request */
+} ServeConn;
+
+typedef struct {
+    ServeConn *conn;
+    long       id;
+    char      *buf;
+    size_t     len;
+} ServeRequest;
+
+typedef struct {
+    ServeRequest   *items;     /* ring of cap slots, count from head */
+    int             head, count, cap;
+    bool            closed;    /* no more requests are coming */
+    pthread_mutex_t lock;
+    pthread_cond_t  nonempty, nonfull;
+    int             restart_policy;
+    bool            preprocess;
+    bool            simplify;
+    bool            fast_path;   /* board_solve() before the search */
+    Budget          budget;
+    PuzzleCache    *cache;       /* asked before loading, or NULL */
+} Server;
+
+typedef struct {
+    Server    *srv;
+    ServeConn *conn;
+} ServeReader;
+
+static ServeConn *conn_new(int fd, bool owns_fd) {
+    ServeConn *c = calloc(1, sizeof *c);
+    if (!c) { fprintf(stderr, "OOM: server connection\n"); exit(1); }
+    c->fd      = fd;
+    c->owns_fd = owns_fd;
+    c->refs    = 1;
+    pthread_mutex_init(&c->lock, NULL);
+    return c;
+}
+
+static void conn_release(ServeConn *c) {
+    pthread_mutex_lock(&c->lock);
+    bool last = --c->refs == 0;
+    pthread_mutex_unlock(&c->lock);
+    if (!last) return;
+    if (c->owns_fd) close(c->fd);
+    pthread_mutex_destroy(&c->lock);
+    free(c);
+}
+
+/* a client that went away just loses its answers */
+static void conn_write(ServeConn *c, const char *msg, size_t len) {
+    pthread_mutex_lock(&c->lock);
+    while (len > 0) {
+        ssize_t n = write(c->fd, msg, len);
+        if (n <= 0) break;
+        msg += n;
+        len -= (size_t)n;
+    }
+    pthread_mutex_unlock(&c->lock);
+}
+
+/* answer lines are built in a growable buffer and written in one go */
+typedef struct {
+    char  *buf;
+    size_t len, cap;
+} Reply;
+
+static void reply_printf(Reply *r, const char *fmt, ...) {
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(r->buf + r->len, r->cap - r->len, fmt, ap);
+        va_end(ap);
+        if (n < 0) return;
+        if ((size_t)n < r->cap - r->len) { r->len += (size_t)n; return; }
+        r->cap = (r->cap + (size_t)n + 1) * 2;
+        r->buf = realloc(r->buf, r->cap);
+        if (!r->buf) { fprintf(stderr, "OOM: server reply\n"); exit(1); }
+    }
+}
+
+static void serve_push(Server *srv, ServeConn *c, long id, char *buf, size_t len) {
+    pthread_mutex_lock(&c->lock);
+    c->refs++;
+    pthread_mutex_unlock(&c->lock);
+
+    pthread_mutex_lock(&srv->lock);
+    while (srv->count == srv->cap) pthread_cond_wait(&srv->nonfull, &srv->lock);
+    srv->items[(srv->head + srv->count++) % srv->cap] =
+        (ServeRequest){ c, id, buf, len };
+    pthread_cond_signal(&srv->nonempty);
+    pthread_mutex_unlock(&srv->lock);
+}
+
+static bool serve_take(Server *srv, ServeRequest *req) {
+    pthread_mutex_lock(&srv->lock);
+    while (srv->count == 0 && !srv->closed)
+        pthread_cond_wait(&srv->nonempty, &srv->lock);
+    bool got = srv->count > 0;
+    if (got) {
+        *req      = srv->items[srv->head];
+        srv->head = (srv->head + 1) % srv->cap;
+        srv->count--;
+        pthread_cond_signal(&srv->nonfull);
+    }
+    pthread_mutex_unlock(&srv->lock);
+    return got;
+}
+
+static int cell_value(char ch) {
+    if (ch == '.' || ch == '0') return 0;
+    if (ch >= '1' && ch <= '9') return ch - '0';
+    if (ch >= 'A' && ch <= 'Z') return ch - 'A' + 10;
+    if (ch >= 'a' && ch <= 'z') return ch - 'a' + 10;
+    return -1;
+}
+
+/*
+ * Rewrites a one-line puzzle as a puzzle file for encode_puzzle(); NULL
+ * unless the line is N² cells for a square N of at most 35 with every
+ * value in range.
+ */
+static char *puzzle_from_line(const char *line, size_t n, size_t *len) {
+    int N = 1, box = 1;
+    while ((size_t)N * (size_t)N < n) N++;
+    while (box * box < N) box++;
+    if ((size_t)N * (size_t)N != n || box * box != N || N > 35) return NULL;
+
+    Reply r = { NULL, 0, 0 };
+    reply_printf(&r, "SIZE %d\nPUZZLE\n", N);
+    for (int i = 0; i < N * N; i++) {
+        int v = cell_value(line[i]);
+        if (v < 0 || v > N) { free(r.buf); return NULL; }
+        reply_printf(&r, "%d%c", v, i % N == N - 1 ? '\n' : ' ');
+    }
+    *len = r.len;
+    return r.buf;
+}
+
+static void reply_grid(Reply *r, long id, const int *grid, int N) {
+    reply_printf(r, "%ld SAT ", id);
+    for (int i = 0; i < N * N; i++) {
+        int v = grid[i];
+        if (N > 35)      reply_printf(r, i ? " %d" : "%d", v);
+        else if (v == 0) reply_printf(r, ".");
+        else             reply_printf(r, "%c", v <= 9 ? '0' + v : 'A' + v - 10);
+    }
+    reply_printf(r, "\n");
+}
+
+static void serve_answer(Solver *s, int res, long id, Reply *r) {
+    r->len = 0;
+    if (res == UNSAT) {
+        reply_printf(r, "%ld UNSAT\n", id);
+    } else if (res != SAT) {
+        reply_printf(r, "%ld UNKNOWN %s\n", id,
+                     s->limit_hit ? s->limit_hit : "stopped");
+    } else if (s->N > 0) {
+        int *grid = decode_grid(s);
+        reply_grid(r, id, grid, s->N);
+        free(grid);
+    } else {
+        reply_printf(r, "%ld SAT", id);
+        for (int v = 1; v <= s->num_vars; v++)
+            reply_printf(r, " %d", var_value(s, v) == 0 ? -v : v);
+        reply_printf(r, " 0\n");
+    }
+}
+
+/*
+ * Empties a solver for the next instance, as if it came from solver_new(),
+ * but keeps every buffer it has grown: a long-lived worker stops paying
+ * for allocation once it has seen its largest board.  Variable 0's slots
+ * are never touched after solver_new(), and resize_vars() reinitialises
+ * the rest as the next instance declares them.
+ */
+static void solver_reset(Solver *s) {
+    Solver k = *s;
+    for (int i = 0; i < 2 * k.var_cap + 2; i++) {
+        k.watches[i].size = 0;
+        k.bins[i].size    = 0;
+        k.amo_occ[i].size = 0;
+    }
+    if (k.var_info) memset(k.var_info, 0, (size_t)k.var_info_cap * sizeof(VarEntry));
+    if (k.lvl_stamp) memset(k.lvl_stamp, 0, (size_t)k.lvl_cap * sizeof(int));
+
+    memset(s, 0, sizeof *s);
+    s->arena      = k.arena;      s->arena_cap    = k.arena_cap;
+    s->learnts    = k.learnts;    s->learnts_cap  = k.learnts_cap;
+    s->var_cap    = k.var_cap;
+    s->value      = k.value;      s->vardata      = k.vardata;
+    s->trail      = k.trail;
+    s->watches    = k.watches;    s->bins         = k.bins;
+    s->amo_lits   = k.amo_lits;   s->amo_lits_cap = k.amo_lits_cap;
+    s->amo_start  = k.amo_start;  s->amo_start_cap = k.amo_start_cap;
+    s->amo_occ    = k.amo_occ;
+    s->activity   = k.activity;   s->heap         = k.heap;
+    s->heap_pos   = k.heap_pos;   s->phase        = k.phase;
+    s->eliminated = k.eliminated;
+    s->elim_stack = k.elim_stack; s->elim_cap     = k.elim_cap;
+    s->lvl_stamp  = k.lvl_stamp;  s->lvl_cap      = k.lvl_cap;
+    s->trail_lim  = k.trail_lim;
+    s->seen       = k.seen;       s->gen_of       = k.gen_of;
+    s->learned    = k.learned;
+    s->an_stack   = k.an_stack;   s->an_toclear   = k.an_toclear;
+    s->add_buf    = k.add_buf;    s->add_cap      = k.add_cap;
+    s->assumps    = k.assumps;    s->assumps_cap  = k.assumps_cap;
+    s->failed     = k.failed;     s->failed_cap   = k.failed_cap;
+    s->var_info   = k.var_info;   s->var_info_cap = k.var_info_cap;
+    s->fixed_flat = k.fixed_flat; s->fixed_cap    = k.fixed_cap;
+    solver_defaults(s);
+}
+
+static void *serve_worker(void *arg) {
+    Server      *srv = arg;
+    Solver      *s   = solver_new();
+    Reply        r   = { NULL, 0, 0 };
+    ServeRequest req;
+    while (serve_take(srv, &req)) {
+        PuzzleKey key;
+        int      *solution;
+        int       res = pcache_query(srv->cache, req.buf, req.len, &key,
+                                     &solution);
+        r.len = 0;
+        if (res == SAT) {
+            reply_grid(&r, req.id, solution, key.cf.N);
+        } else if (res == UNSAT) {
+            reply_printf(&r, "%ld UNSAT\n", req.id);
+        } else {
+            solver_reset(s);
+            s->restart_policy = srv->restart_policy;
+            s->preprocess     = srv->preprocess;
+            s->budget         = srv->budget;
+            bool ok;
+            load_buffer(s, req.buf, req.len, &ok);
+            if (ok) {
+                if (srv->fast_path) res = board_solve(s);
+                if (res == UNASSIGNED) {
+                    if (srv->simplify) simplify(s);
+                    res = solve(s);
+                }
+                if (res == SAT) extend_model(s);
+                pcache_record(srv->cache, &key, s, res);
+                serve_answer(s, res, req.id, &r);
+            } else {
+                reply_printf(&r, "%ld ERROR malformed instance\n", req.id);
+            }
+        }
+        if (key.keyed) canon_free(&key.cf);
+        free(solution);
+        free(req.buf);
+        conn_write(req.conn, r.buf, r.len);
+        conn_release(req.conn);
+    }
+    free(r.buf);
+    solver_free(s);
+    return NULL;
+}
+
+/* turns one input stream into requests until EOF or a framing error */
+static void serve_read(Server *srv, ServeConn *c, FILE *in) {
+    char   *line = NULL;
+    size_t  cap  = 0;
+    ssize_t n;
+    long    id   = 0;
+    Reply   err  = { NULL, 0, 0 };
+    while ((n = getline(&line, &cap, in)) > 0) {
+        while (n > 0 && (line[n-1] == '\n' || line[n-1] == '\r' ||
+                         line[n-1] == ' '  || line[n-1] == '\t'))
+            line[--n] = '\0';
+        if (n == 0) continue;
+        id++;
+
+        size_t len;
+        char  *buf = NULL;
+        if (line[0] == '@') {
+            char *end;
+            long  want = strtol(line + 1, &end, 10);
+            if (*end != '\0' || want <= 0 || want > SERVE_MAX_REQUEST) {
+                err.len = 0;
+                reply_printf(&err, "%ld ERROR bad request length\n", id);
+                conn_write(c, err.buf, err.len);
+                break;              /* the stream is out of step: drop it */
+            }
+            buf = malloc((size_t)want);
+            if (!buf) { fprintf(stderr, "OOM: server request\n"); exit(1); }
+            len = fread(buf, 1, (size_t)want, in);
+            if (len < (size_t)want) { free(buf); break; }
+        } else if (!(buf = puzzle_from_line(line, (size_t)n, &len))) {
+            err.len = 0;
+            reply_printf(&err, "%ld ERROR not a puzzle line\n", id);
+            conn_write(c, err.buf, err.len);
+            continue;
+        }
+        serve_push(srv, c, id, buf, len);
+    }
+    free(err.buf);
+    free(line);
+}
+
+static void *serve_client(void *arg) {
+    ServeReader *rd = arg;
+    FILE *in = fdopen(rd->conn->fd, "r");
+    if (in) {
+        rd->conn->fd = dup(rd->conn->fd);  /* fclose() takes the original */
+        if (rd->conn->fd >= 0) serve_read(rd->srv, rd->conn, in);
+        else                   rd->conn->owns_fd = false;
+        fclose(in);
+    }
+    conn_release(rd->conn);
+    free(rd);
+    return NULL;
+}
+
+static int serve_socket(Server *srv, const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof addr.sun_path) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return 1;
+    }
+    strcpy(addr.sun_path, path);
+
+    /* a socket left behind by an earlier server is replaced, nothing else */
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof addr) != 0 ||
+        listen(fd, 64) != 0) {
+        fprintf(stderr, "Cannot listen on %s\n", path);
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+    fprintf(stderr, "c listening on %s\n", path);
+    for (;;) {
+        int cfd = accept(fd, NULL, NULL);
+        if (cfd < 0) continue;
+        ServeReader *rd = malloc(sizeof *rd);
+        if (!rd) { fprintf(stderr, "OOM: server connection\n"); exit(1); }
+        rd->srv  = srv;
+        rd->conn = conn_new(cfd, true);
+        pthread_t t;
+        if (pthread_create(&t, NULL, serve_client, rd) != 0) {
+            conn_release(rd->conn);
+            free(rd);
+            continue;
+        }
+        pthread_detach(t);
+    }
+}
+
+static int run_server(const char *socket_path, int jobs, int restart_policy,
+                      bool preprocess, bool simp, bool fast_path,
+                      Budget budget, PuzzleCache *cache) {
+    Server srv;
+    memset(&srv, 0, sizeof srv);
+    srv.restart_policy = restart_policy;
+    srv.preprocess     = preprocess;
+    srv.simplify       = simp;
+    srv.fast_path      = fast_path;
+    srv.budget         = budget;
+    srv.cache          = cache;
+
+    if (jobs <= 0) jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs < 1) jobs = 1;
+    srv.cap   = 4 * jobs;           /* enough to keep every worker busy */
+    srv.items = calloc((size_t)srv.cap, sizeof(ServeRequest));
+    pthread_t *threads = calloc((size_t)jobs, sizeof(pthread_t));
+    if (!srv.items || !threads) { fprintf(stderr, "OOM: server\n"); exit(1); }
+    pthread_mutex_init(&srv.lock, NULL);
+    pthread_cond_init(&srv.nonempty, NULL);
+    pthread_cond_init(&srv.nonfull, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    for (int w = 0; w < jobs; w++)
+        if (pthread_create(&threads[w], NULL, serve_worker, &srv) != 0) {
+            fprintf(stderr, "Cannot start server worker\n"); exit(1);
+        }
+
+    int rc = 0;
+    if (socket_path) {
+        rc = serve_socket(&srv, socket_path);
+    } else {
+        ServeConn *c = conn_new(STDOUT_FILENO, false);
+        serve_read(&srv, c, stdin);
+        conn_release(c);
+    }
+
+    pthread_mutex_lock(&srv.lock);
+    srv.closed = true;
+    pthread_cond_broadcast(&srv.nonempty);
+    pthread_mutex_unlock(&srv.lock);
+    for (int w = 0; w < jobs; w++) pthread_join(threads[w], NULL);
+
+    pthread_cond_destroy(&srv.nonfull);
+    pthread_cond_destroy(&srv.nonempty);
+    pthread_mutex_destroy(&srv.lock);
+    free(srv.items);
+    free(threads);
+    return rc;
+}
+
+#ifndef CDCL_BENCH     /* cdcl_bench.c brings its own main */
+
+/* ══════════════════════════════════════════════════════════════════════════ */
+/* main                                                                       */
+/* ══════════════════════════════════════════════════════════════════════════ */
+
+/* --count: every model as it is found, numbered */
+static void print_counted(Solver *s, int found, void *data) {
+    (void)data;
+    printf("c solution %d\n", found);
+    print_result(s, SAT);
+    decode_and_print_sudoku(s);
+}
+
+/* prints up to limit solutions and how many there are; SAT if any */
+static int run_count(Solver *s, int limit) {
+    int last, found = count_models(s, limit, &last, print_counted, NULL);
+    if (!found) print_result(s, last);
+    if (last == UNSAT)    printf("c solutions %d\n", found);
+    else if (last == SAT) printf("c solutions %d or more\n", found);
+    else                  printf("c solutions %d or more (%s limit)\n", found,
+                                 s->limit_hit ? s->limit_hit : "search");
+    return found ? SAT : last;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [options] file.cnf|file.cnfb|puzzle.txt\n"
+        "       %s --batch [options] directory|manifest\n"
+        "       %s --serve[=SOCKET] [options]\n"
+        "  --restart=luby|glucose|none   restart policy (default: luby)\n"
+        "  --convert                     write file.cnfb next to file.cnf and exit\n"
+        "  --cache                       also write file.cnfb when it is missing\n"
+        "                                or stale (it is read whenever fresh)\n"
+        "  --no-cache                    ignore any file.cnfb\n"
+        "  --batch                       solve every .cnf/.cnfb/.txt in a directory,\n"
+        "                                or every path listed in a manifest\n"
+        "  --jobs=N                      batch and server worker threads (default:\n"
+        "                                one per online CPU)\n"
+        "  --serve                       answer a stream of puzzles and instances\n"
+        "                                on standard input, one line each\n"
+        "  --serve=SOCKET                ... from every client of a Unix socket\n"
+        "  --portfolio=K                 race K differently configured solver\n"
+        "                                threads on the instance\n"
+        "  --no-share                    portfolio threads keep what they learn\n"
+        "                                to themselves\n"
+        "  --cubes=D                     split into up to 2^D cubes by lookahead\n"
+        "                                and solve them on --jobs threads\n"
+        "  --cube-out=FILE               with --cubes: write the cubes as iCNF\n"
+        "                                instead of solving\n"
+        "  --no-preprocess               encode puzzle files without applying\n"
+        "                                Sudoku rules first (keeps the variable\n"
+        "                                numbering of sudoku_to_cnf.py)\n"
+        "  --no-simplify                 skip subsumption, variable elimination\n"
+        "                                and failed-literal probing\n"
+        "  --no-fast-path                solve puzzle files up to 16x16 by CDCL\n"
+        "                                too, not on the bitboard first\n"
+        "  --count[=K]                   print up to K solutions (default: 2, so\n"
+        "                                one means unique) and their number\n"
+        "  --puzzle-cache=FILE           answer puzzle files equivalent under the\n"
+        "                                Sudoku symmetries to one solved before\n"
+        "                                from FILE, and add new answers to it\n"
+        "  --no-puzzle-cache             --batch and --serve keep no in-memory\n"
+        "                                puzzle cache either\n"
+        "  --stats                       print search counters and phase times\n"
+        "                                as 'c stat' lines after the answer\n"
+        "  --stats-json=FILE             write them to FILE as JSON ('-' for\n"
+        "                                standard output)\n"
+        "  --time-limit=SEC              give up with UNKNOWN after SEC seconds\n"
+        "                                of search (per instance with --batch or\n"
+        "                                --serve)\n"
+        "  --conflict-limit=N            ... or after N conflicts\n"
+        "  --mem-limit=MB                ... or once the clauses held (arena plus\n"
+        "                                watcher lists) pass MB\n",
+        prog, prog, prog);
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    bool convert     = false;
+    int  cache_flags = CACHE_READ;
+    int  policy      = RESTART_LUBY;
+    bool batch       = false;
+    bool serve       = false;
+    const char *socket_path = NULL;
+    int  jobs        = 0;
+    int  portfolio   = 1;
+    bool share       = true;
+    bool preprocess  = true;
+    bool simp        = true;
+    bool fast_path   = true;
+    int  cube_depth  = 0;
+    const char *cube_out = NULL;
+    int  count_limit = 0;
+    const char *pcache_path = NULL;
+    bool pcache      = true;
+    bool stats       = false;
+    const char *stats_json = NULL;
+    Budget budget    = { 0, 0, 0 };
+    double t_start   = now_ms();
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (strncmp(a, "--restart=", 10) == 0) {
+            const char *p = a + 10;
+            if      (strcmp(p, "luby")    == 0) policy = RESTART_LUBY;
+            else if (strcmp(p, "glucose") == 0) policy = RESTART_GLUCOSE;
+            else if (strcmp(p, "none")    == 0) policy = RESTART_NONE;
+            else { fprintf(stderr, "Unknown restart policy: %s\n", p); return 1; }
+        } else if (strcmp(a, "--convert") == 0) {
+            convert = true;
+        } else if (strcmp(a, "--batch") == 0) {
+            batch = true;
+        } else if (strcmp(a, "--serve") == 0) {
+            serve = true;
+        } else if (strncmp(a, "--serve=", 8) == 0) {
+            serve       = true;
+            socket_path = a + 8;
+        } else if (strncmp(a, "--portfolio=", 12) == 0) {
+            portfolio = atoi(a + 12);
+            if (portfolio < 1) {
+                fprintf(stderr, "Bad portfolio size: %s\n", a + 12); return 1;
+            }
+        } else if (strncmp(a, "--cubes=", 8) == 0) {
+            cube_depth = atoi(a + 8);
+            if (cube_depth < 1 || cube_depth > 24) {
+                fprintf(stderr, "Bad cube depth: %s\n", a + 8); return 1;
+            }
+        } else if (strcmp(a, "--count") == 0) {
+            count_limit = 2;
+        } else if (strncmp(a, "--count=", 8) == 0) {
+            count_limit = atoi(a + 8);
+            if (count_limit < 1) {
+                fprintf(stderr, "Bad solution count: %s\n", a + 8); return 1;
+            }
+        } else if (strncmp(a, "--puzzle-cache=", 15) == 0) {
+            pcache_path = a + 15;
+        } else if (strcmp(a, "--no-puzzle-cache") == 0) {
+            pcache = false;
+        } else if (strncmp(a, "--cube-out=", 11) == 0) {
+            cube_out = a + 11;
+        } else if (strcmp(a, "--no-share") == 0) {
+            share = false;
+        } else if (strcmp(a, "--no-preprocess") == 0) {
+            preprocess = false;
+        } else if (strcmp(a, "--no-simplify") == 0) {
+            simp = false;
+        } else if (strcmp(a, "--no-fast-path") == 0) {
+            fast_path = false;
+        } else if (strcmp(a, "--stats") == 0) {
+            stats = true;
+        } else if (strncmp(a, "--stats-json=", 13) == 0) {
+            stats_json = a + 13;
+        } else if (strncmp(a, "--time-limit=", 13) == 0) {
+            budget.time_ms = atof(a + 13) * 1e3;
+            if (budget.time_ms <= 0) {
+                fprintf(stderr, "Bad time limit: %s\n", a + 13); return 1;
+            }
+        } else if (strncmp(a, "--conflict-limit=", 17) == 0) {
+            budget.conflicts = atol(a + 17);
+            if (budget.conflicts <= 0) {
+                fprintf(stderr, "Bad conflict limit: %s\n", a + 17); return 1;
+            }
+        } else if (strncmp(a, "--mem-limit=", 12) == 0) {
+            long mb = atol(a + 12);
+            if (mb <= 0) { fprintf(stderr, "Bad memory limit: %s\n", a + 12); return 1; }
+            budget.mem_bytes = (size_t)mb << 20;
+        } else if (strncmp(a, "--jobs=", 7) == 0) {
+            jobs = atoi(a + 7);
+            if (jobs < 1) { fprintf(stderr, "Bad job count: %s\n", a + 7); return 1; }
+        } else if (strcmp(a, "--cache") == 0) {
+            cache_flags |= CACHE_WRITE;
+        } else if (strcmp(a, "--no-cache") == 0) {
+            cache_flags = 0;
+        } else if (a[0] == '-' && a[1] == '-') {
+            fprintf(stderr, "Unknown option: %s\n", a);
+            usage(argv[0]);
+            return 1;
+        } else {
+            path = a;
+        }
+    }
+    if (!path && !serve) { usage(argv[0]); return 1; }
+    if ((batch != 0) + (convert != 0) + (portfolio > 1) + (cube_depth > 0) +
+        (count_limit > 0) + (serve != 0) > 1) {
+        fprintf(stderr, "--batch, --convert, --portfolio, --cubes, --count and "
+                        "--serve are mutually exclusive\n");
+        return 1;
+    }
+    if (serve && path) {
+        fprintf(stderr, "--serve reads its instances from the stream\n");
+        return 1;
+    }
+    if (cube_out && !cube_depth) {
+        fprintf(stderr, "--cube-out needs --cubes\n");
+        return 1;
+    }
+    if ((stats || stats_json) && (batch || convert || cube_out || serve)) {
+        fprintf(stderr, "--stats and --stats-json report a single solve\n");
+        return 1;
+    }
+    if (pcache_path && !pcache) {
+        fprintf(stderr, "--puzzle-cache and --no-puzzle-cache contradict\n");
+        return 1;
+    }
+
+    /* batch and server runs keep one in memory even without a file */
+    PuzzleCache *pc = NULL;
+    if (pcache_path || (pcache && (batch || serve))) {
+        if (!(pc = pcache_new(pcache_path))) return 1;
+    }
+    if (serve || batch) {
+        int rc = serve ? run_server(socket_path, jobs, policy, preprocess, simp,
+                                    fast_path, budget, pc)
+                       : run_batch(path, jobs, policy, cache_flags, preprocess,
+                                   simp, fast_path, budget, pc);
+        pcache_free(pc);
+        return rc;
+    }
+
+    Solver *s = solver_new();
+    s->restart_policy = policy;
+    s->preprocess     = preprocess;
+    s->budget         = budget;
+
+    if (convert) {
+        struct stat st;
+        if (!load_instance(s, path, 0)) { solver_free(s); return 1; }
+        stat(path, &st);
+        char *out = cache_path_for(path);
+        bool  ok  = write_cnfb(s, out, &st);
+        if (ok) printf("c wrote %s\n", out);
+        else    fprintf(stderr, "Could not write %s\n", out);
+        free(out);
+        solver_free(s);
+        pcache_free(pc);
+        return ok ? 0 : 1;
+    }
+
+    RunStats rs = { path, 0, 0, 0, 0, 0, 0, 0, false };
+    double   t  = now_ms();
+    if (!load_instance(s, path, cache_flags)) {
+        solver_free(s);
+        pcache_free(pc);
+        return 1;
+    }
+    rs.vars     = s->num_vars;
+    rs.clauses  = s->num_clauses;
+    rs.groups   = s->num_amo;
+    rs.parse_ms = now_ms() - t;
+
+    /* a board the cache or the bitboard answers never reaches simplify() or
+       the search, and counting searches the whole encoding without either;
+       the cached solution still becomes a model of the encoding, for the
+       'v' line */
+    PuzzleKey key = { .keyed = false };
+    int      *solution = NULL;
+    int       res      = UNASSIGNED;
+    t = now_ms();
+    if (count_limit > 0) {
+        res = run_count(s, count_limit);
+    } else if (!cube_out) {
+        res = pcache_query_file(pc, path, &key, &solution);
+        rs.cached = res != UNASSIGNED;
+        if (res == SAT) grid_model(s, solution);
+        if (res == UNASSIGNED && fast_path) res = board_solve(s);
+    }
+    rs.solve_ms = now_ms() - t;
+    if (res == UNASSIGNED) {
+        t = now_ms();
+        if (simp && !cube_out) simplify(s);
+        rs.simplify_ms = now_ms() - t;
+
+        t = now_ms();
+        if (cube_depth > 0) {
+            res = run_cubes(s, cube_depth, jobs, cube_out);
+            if (cube_out) {
+                solver_free(s);
+                pcache_free(pc);
+                return res == UNKNOWN ? 0 : 1;
+            }
+        } else if (portfolio > 1) {
+            res = run_portfolio(s, portfolio, share);
+        } else {
+            res = solve(s);
+        }
+        rs.solve_ms += now_ms() - t;
+    }
+    if (!count_limit) {
+        if (res == SAT) extend_model(s);
+        if (!rs.cached) pcache_record(pc, &key, s, res);
+        print_result(s, res);
+        if (res == SAT) decode_and_print_sudoku(s);
+    }
+    if (key.keyed) canon_free(&key.cf);
+    free(solution);
+
+    rs.total_ms = now_ms() - t_start;
+    if (stats) print_stats(s, res, &rs, stdout, false);
+    if (stats_json) {
+        FILE *f = strcmp(stats_json, "-") == 0 ? stdout : fopen(stats_json, "w");
+        if (f) {
+            print_stats(s, res, &rs, f, true);
+            if (f != stdout) fclose(f);
+        } else {
+            fprintf(stderr, "Could not write %s\n", stats_json);
+        }
+    }
+
+    solver_free(s);
+    pcache_free(pc);
+    return 0;
+}
+
+#endif /* CDCL_BENCH */
+
+#endif /* CDCL_NO_MAIN */
@@ -0,0 +1,102 @@
+/*  ═══════════════════════════════════════════════════════════════════════════
+    Incremental interface of cdcl_implementation.c — the standard IPASIR API
+    (https://github.com/biotomas/ipasir), plus the cdcl_* calls below for
+    loading, budgets and reading out whole models and grids.
+
+    Build the solver without its command line and link it in:
+
+        gcc -O2 -DCDCL_NO_MAIN -c cdcl_implementation.c
+        gcc -O2 app.c cdcl_implementation.o
+
+    or as a shared library (Main/cdcl_lib.py loads it through ctypes):
+
+        gcc -O2 -std=c11 -pthread -fPIC -shared -DCDCL_NO_MAIN \
+            -o libcdcl.so cdcl_implementation.c
+
+    Typical Sudoku use: load the base encoding once, then for every query
+    assume the givens and solve.  Learned clauses are kept between calls.
+    ═══════════════════════════════════════════════════════════════════════════ */
+
+#ifndef CDCL_IPASIR_H
+#define CDCL_IPASIR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+const char *ipasir_signature(void);
+
+/* new solver with no variables or clauses */
+void *ipasir_init(void);
+void  ipasir_release(void *solver);
+
+/* add lit to the current clause; 0 terminates it.  Variables are created */
+/* on first use.                                                          */
+void ipasir_add(void *solver, int32_t lit);
+
+/* assume lit for the next ipasir_solve() only */
+void ipasir_assume(void *solver, int32_t lit);
+
+/* 10 = SAT, 20 = UNSAT, 0 = interrupted by the terminate callback or */
+/* stopped by a cdcl_set_limits() budget                               */
+int ipasir_solve(void *solver);
+
+/* after SAT: lit if lit is true in the model, -lit if it is false */
+int32_t ipasir_val(void *solver, int32_t lit);
+
+/* after UNSAT: 1 if assumption lit was used to refute the assumptions */
+int ipasir_failed(void *solver, int32_t lit);
+
+/* terminate(data) is polled once per conflict; nonzero stops the search */
+void ipasir_set_terminate(void *solver, void *data,
+                          int (*terminate)(void *data));
+
+/* learn(data, clause) sees each learned clause of at most max_length  */
+/* literals, 0-terminated; the buffer is only valid during the call    */
+void ipasir_set_learn(void *solver, void *data, int max_length,
+                      void (*learn)(void *data, int32_t *clause));
+
+/* not IPASIR: budgets for each later ipasir_solve() — wall-clock       */
+/* seconds, conflicts, and megabytes of clauses held (live arena words  */
+/* plus watcher and binary list entries, not reserved capacity); 0      */
+/* means none                                                           */
+void cdcl_set_limits(void *solver, double seconds, long conflicts,
+                     long megabytes);
+
+/* not IPASIR: add the clauses of a .cnf or .cnfb file, read its Sudoku */
+/* comments; returns 0 if the file cannot be read                        */
+int cdcl_load(void *solver, const char *path);
+
+/* not IPASIR: cdcl_load() from memory — DIMACS, .cnfb or a puzzle file   */
+/* (SIZE N, PUZZLE, N rows) */
+int cdcl_load_buffer(void *solver, const char *buf, size_t len);
+
+/* not IPASIR: ipasir_add() of len literals, 0-terminated clauses back to */
+/* back; a trailing clause without its 0 stays open                       */
+void cdcl_add_clauses(void *solver, const int32_t *lits, size_t len);
+
+/* not IPASIR: the highest variable seen so far */
+int cdcl_num_vars(void *solver);
+
+/* not IPASIR: ipasir_val() of variables 1..n into model[0..n); returns */
+/* how many were written (at most cdcl_num_vars())                      */
+int cdcl_model(void *solver, int32_t *model, int n);
+
+/* not IPASIR: solves repeatedly, excluding each model (by its Sudoku  */
+/* cells when it has any), until limit are found or no other is left;  */
+/* returns how many, or -1 if a budget stopped it first.  The excluding */
+/* clauses stay, so later solves only find models not yet counted      */
+int cdcl_count(void *solver, int limit);
+
+/* not IPASIR: N for a loaded Sudoku, 0 without one.  With grid != NULL */
+/* it also receives the N*N cells row by row, 0 where none is known     */
+int cdcl_grid(void *solver, int32_t *grid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CDCL_IPASIR_H */
@@ -0,0 +1,209 @@
+"""
+cdcl_lib.py
+In-process access to the CDCL solver in ../CDCL through its shared library,
+so the pipeline can hand over clause arrays and read models back without
+spawning a process or parsing a "v ..." line.
+
+Build the library once (next to cdcl_implementation.c, or into executable/):
+
+  gcc -O2 -std=c11 -pthread -fPIC -shared -DCDCL_NO_MAIN \\
+      -o CDCL/libcdcl.so CDCL/cdcl_implementation.c
+
+The calls are the IPASIR API plus the cdcl_* extensions declared in
+CDCL/ipasir.h.  $CDCL_LIB overrides where the library is looked for.
+"""
+
+import os
+import time
+import ctypes
+from array import array
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+
+LIB_CANDIDATES = [
+    os.path.join(SCRIPT_DIR, "executable", "libcdcl.so"),
+    os.path.join(SCRIPT_DIR, "..", "CDCL", "libcdcl.so"),
+]
+
+SAT, UNSAT, UNKNOWN = 10, 20, 0
+
+_lib = None
+
+
+# ── library loading ────────────────────────────────────────────────────────────
+
+def find_library(preferred=None):
+    """Path of libcdcl.so, or None when it has not been built."""
+    for c in [preferred, os.environ.get("CDCL_LIB")] + LIB_CANDIDATES:
+        if c and os.path.isfile(c):
+            return os.path.abspath(c)
+    return None
+
+
+def load_library(path=None):
+    global _lib
+    if _lib is not None and path is None:
+        return _lib
+    found = find_library(path)
+    if not found:
+        raise OSError("libcdcl.so not found; build it as described in cdcl_lib.py")
+    lib = ctypes.CDLL(found)
+
+    vp, i32p = ctypes.c_void_p, ctypes.POINTER(ctypes.c_int32)
+    sigs = {
+        "ipasir_init":      (vp,             []),
+        "ipasir_release":   (None,           [vp]),
+        "ipasir_add":       (None,           [vp, ctypes.c_int32]),
+        "ipasir_assume":    (None,           [vp, ctypes.c_int32]),
+        "ipasir_solve":     (ctypes.c_int,   [vp]),
+        "ipasir_val":       (ctypes.c_int32, [vp, ctypes.c_int32]),
+        "ipasir_failed":    (ctypes.c_int,   [vp, ctypes.c_int32]),
+        "cdcl_set_limits":  (None,           [vp, ctypes.c_double, ctypes.c_long,
+                                              ctypes.c_long]),
+        "cdcl_load":        (ctypes.c_int,   [vp, ctypes.c_char_p]),
+        "cdcl_load_buffer": (ctypes.c_int,   [vp, ctypes.c_char_p, ctypes.c_size_t]),
+        "cdcl_add_clauses": (None,           [vp, i32p, ctypes.c_size_t]),
+        "cdcl_num_vars":    (ctypes.c_int,   [vp]),
+        "cdcl_model":       (ctypes.c_int,   [vp, i32p, ctypes.c_int]),
+        "cdcl_grid":        (ctypes.c_int,   [vp, i32p]),
+        "cdcl_count":       (ctypes.c_int,   [vp, ctypes.c_int]),
+    }
+    for name, (res, args) in sigs.items():
+        fn = getattr(lib, name)
+        fn.restype, fn.argtypes = res, args
+    if path is None:
+        _lib = lib
+    return lib
+
+
+# ── solver ─────────────────────────────────────────────────────────────────────
+
+class Solver:
+    """One incremental solver; clauses and learned clauses persist across solve()."""
+
+    def __init__(self, lib_path=None):
+        self._lib = load_library(lib_path)
+        self._s   = self._lib.ipasir_init()
+
+    def close(self):
+        if self._s:
+            self._lib.ipasir_release(self._s)
+            self._s = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+    def add_clauses(self, clauses):
+        """clauses: an iterable of literal lists, as encode() returns them."""
+        flat = array("i")
+        for c in clauses:
+            flat.extend(c)
+            flat.append(0)
+        if len(flat):
+            buf = (ctypes.c_int32 * len(flat)).from_buffer(flat)
+            self._lib.cdcl_add_clauses(self._s, buf, len(flat))
+
+    def load_file(self, path):
+        """A .cnf/.cnfb file, with its Sudoku comments."""
+        return bool(self._lib.cdcl_load(self._s, os.fsencode(path)))
+
+    def load_buffer(self, data):
+        """DIMACS, .cnfb or puzzle-file contents (str or bytes)."""
+        if isinstance(data, str):
+            data = data.encode()
+        return bool(self._lib.cdcl_load_buffer(self._s, data, len(data)))
+
+    def set_limits(self, seconds=0, conflicts=0, megabytes=0):
+        self._lib.cdcl_set_limits(self._s, float(seconds or 0),
+                                  int(conflicts or 0), int(megabytes or 0))
+
+    def solve(self, assumptions=()):
+        """SAT (10), UNSAT (20) or UNKNOWN (0, a limit was hit)."""
+        for lit in assumptions:
+            self._lib.ipasir_assume(self._s, lit)
+        return self._lib.ipasir_solve(self._s)
+
+    @property
+    def num_vars(self):
+        return self._lib.cdcl_num_vars(self._s)
+
+    def model(self):
+        """After SAT: [±1, ±2, ..., ±num_vars], in one call."""
+        n   = self.num_vars
+        buf = (ctypes.c_int32 * max(n, 1))()
+        n   = self._lib.cdcl_model(self._s, buf, n)
+        return buf[:n]
+
+    def true_vars(self):
+        return [v for v in self.model() if v > 0]
+
+    def count(self, limit=2):
+        """Models up to limit (2 answers "unique?"), or -1 if a limit stopped it.
+        Each one found is excluded from every later solve()."""
+        return self._lib.cdcl_count(self._s, limit)
+
+    def failed(self, lit):
+        return bool(self._lib.ipasir_failed(self._s, lit))
+
+    def grid(self):
+        """After SAT on an instance with Sudoku metadata: N rows of N values."""
+        n = self._lib.cdcl_grid(self._s, None)
+        if n <= 0:
+            return None
+        buf = (ctypes.c_int32 * (n * n))()
+        self._lib.cdcl_grid(self._s, buf)
+        return [buf[r * n:(r + 1) * n] for r in range(n)]
+
+
+# ── convenience ────────────────────────────────────────────────────────────────
+
+def solve_file(cnf_path, timeout=None, lib_path=None):
+    """(status, true variables, seconds) for a CNF file, run in-process."""
+    with Solver(lib_path) as s:
+        t0 = time.time()
+        if not s.load_file(cnf_path):
+            raise OSError(f"cannot load {cnf_path}")
+        if timeout:
+            s.set_limits(seconds=timeout)
+        status = s.solve()
+        elapsed = time.time() - t0
+        return status, s.true_vars() if status == SAT else [], elapsed
+
+
+def puzzle_text(n, puzzle):
+    """The puzzle-file form cdcl_load_buffer() reads."""
+    rows = "\n".join(" ".join(str(v) for v in row) for row in puzzle)
+    return f"SIZE {n}\nPUZZLE\n{rows}\n"
+
+
+def count_puzzle(n, puzzle, limit=2, timeout=None, lib_path=None):
+    """Solutions of a puzzle up to limit: 1 means unique.  -1 on timeout."""
+    with Solver(lib_path) as s:
+        if not s.load_buffer(puzzle_text(n, puzzle)):
+            raise ValueError("puzzle not accepted by the solver")
+        if timeout:
+            s.set_limits(seconds=timeout)
+        return s.count(limit)
+
+
+def solve_puzzle(n, puzzle, lib_path=None):
+    """Encode with sudoku_to_cnf.encode(), solve, decode: the grid, or None."""
+    from sudoku_to_cnf import encode
+
+    clauses, num_vars, var_map, _ = encode(n, puzzle)
+    with Solver(lib_path) as s:
+        s.add_clauses(clauses)
+        if s.solve() != SAT:
+            return None
+        model = s.model()
+    grid = [row[:] for row in puzzle]
+    for (r, c, v), idx in var_map.items():
+        if idx <= len(model) and model[idx - 1] > 0:
+            grid[r - 1][c - 1] = v
+    return grid
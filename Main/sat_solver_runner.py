@@ -25,8 +25,15 @@ def find_solver(preferred=None):
     for name in ["satch", "minisat", "picosat", "glucose", "Solver"]:
         candidates.append(os.path.join(exe_dir, name))
         candidates.append(name)
+    # the in-process CDCL library (see cdcl_lib.py) when nothing else is there
+    candidates.append(os.path.join(exe_dir, "libcdcl.so"))
+    candidates.append(os.path.join(SCRIPT_DIR, "..", "CDCL", "libcdcl.so"))
 
     for c in candidates:
+        if c.endswith(".so"):
+            if os.path.isfile(c):
+                return os.path.abspath(c)
+            continue
         if os.path.isfile(c) and os.access(c, os.X_OK):
             return c
         try:
@@ -41,6 +48,14 @@ def find_solver(preferred=None):
 # ── run solver ─────────────────────────────────────────────────────────────────
 
 def run_solver(solver, cnf_path, timeout=3600):
+    if solver.endswith(".so"):
+        # no process and no text: the model comes back as an int array
+        sys.path.insert(0, SCRIPT_DIR)
+        import cdcl_lib
+        status, assignment, elapsed = cdcl_lib.solve_file(
+            cnf_path, timeout=timeout, lib_path=solver)
+        return status == cdcl_lib.SAT, assignment, elapsed
+
     solver_name = os.path.basename(solver).lower()
     out_file    = os.path.join(TEMP_DIR, os.path.basename(cnf_path) + ".out")
 
@@ -63,6 +63,31 @@ def remove_cells(grid, n, num_clues):
     return puzzle
 
 
+def remove_cells_unique(grid, n, num_clues):
+    """
+    Like remove_cells(), but a clue only goes if the puzzle keeps exactly one
+    solution, checked in-process by cdcl_lib.count_puzzle().  Stops at
+    num_clues or once no clue can go, so it may leave more.
+    """
+    from cdcl_lib import count_puzzle
+
+    puzzle = [row[:] for row in grid]
+    cells  = [(r, c) for r in range(n) for c in range(n)]
+    random.shuffle(cells)
+
+    clues = n * n
+    for r, c in cells:
+        if clues <= num_clues:
+            break
+        puzzle[r][c] = 0
+        if count_puzzle(n, puzzle) == 1:
+            clues -= 1
+        else:
+            puzzle[r][c] = grid[r][c]
+
+    return puzzle
+
+
 def default_clues(n):
     clue_map = {
         4: 8,
@@ -100,7 +125,7 @@ def save_puzzle(puzzle, solution, n, puzzle_id):
 # 4. DRIVER
 # ───────────────────────────────────────────────────────────────
 
-def generate_puzzles_for_size(n, count=1, seed=None):
+def generate_puzzles_for_size(n, count=1, seed=None, unique=False):
     if n not in VALID_SIZES:
         raise ValueError(f"Size {n} not supported.")
 
@@ -115,7 +140,10 @@ def generate_puzzles_for_size(n, count=1, seed=None):
         t0 = time.time()
 
         solution = generate_solution(n)
-        puzzle   = remove_cells(solution, n, clues)
+        if unique:
+            puzzle = remove_cells_unique(solution, n, clues)
+        else:
+            puzzle = remove_cells(solution, n, clues)
 
         fname = save_puzzle(puzzle, solution, n, i + 1)
         print(f"done ({time.time()-t0:.2f}s)")
@@ -130,11 +158,14 @@ def main():
     parser.add_argument("--sizes", nargs="+", type=int, default=VALID_SIZES)
     parser.add_argument("--count", type=int, default=1)
     parser.add_argument("--seed", type=int, default=42)
+    parser.add_argument("--unique", action="store_true",
+                        help="only remove clues while the solution stays unique "
+                             "(needs libcdcl.so, see cdcl_lib.py)")
     args = parser.parse_args()
 
     for size in args.sizes:
         print(f"\n── {size}x{size} ──")
-        generate_puzzles_for_size(size, args.count, args.seed)
+        generate_puzzles_for_size(size, args.count, args.seed, args.unique)
 
     print("\nSaved to:", os.path.abspath(PUZZLES_DIR))
 